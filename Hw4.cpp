@@ -7,6 +7,7 @@
 #include <chrono>
 #include <thread>
 #include "keypad.h"
+#include "gpio.h"
 
 using namespace std;
 
@@ -33,12 +34,24 @@ int main(){
     signal(SIGINT, sig_handler);
 
     // Create the Keypad instance and start its thread
-    Keypad kp(colPins, rowPins);
+    unique_ptr<GpioBackend> gpio;
+    try {
+        gpio = make_gpio_backend();
+    }
+    catch (const char *message) {   // The register block can't be opened off the Pi
+        cerr << message << endl;
+        return 1;
+    }
+    Keypad kp(colPins, rowPins, *gpio);
     kp.run();
 
     int counter = 0;
     while(running) {
-        string digit = kp.get_digit();
+        // Wait briefly so Ctrl+C is noticed even when no key comes
+        KeyEvent event;
+        if (!kp.try_get_event(event, std::chrono::milliseconds(100))) continue;
+        if (!event.pressed) continue;   // Releases aren't typed
+        string digit(1, event.key);
 
         if(digit == "*") {        // Backspace: remove last character if any
             if(counter > 0) {
@@ -55,7 +68,6 @@ int main(){
             counter++;
         }
         cout.flush();
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
     }
 
     cout << "\nExiting" << endl;
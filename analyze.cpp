@@ -0,0 +1,532 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Streaming analyzer for captured READY/START/PLAY transcripts
+   Authors: Paolo Saliba and Brayton Alvarez
+
+   A transcript holds one protocol frame per line:
+
+     [<time>] <stream> <player> <frame>
+
+   time is optional, in seconds with a fraction (1712345678.000125).
+   stream tags the game stream (a table or a pair of connections) and
+   player the connection the frame came from, or for START the one it went
+   to; neither may contain spaces. frame is the line as sent, without its
+   line ending. Lines starting with '#' are ignored. Streams may be
+   interleaved in any way, and a stream may carry one game after another.
+
+   The files are memory-mapped and read front to back by every thread, in
+   the order given, as one capture. Each thread only handles the streams
+   whose tag hashes to it, so a stream is always seen in order by one
+   thread and no thread needs to wait for another. A stream's state is
+   dropped as soon as its game ends, and the pages already read are
+   released, so memory stays flat however big the capture is.
+
+   Frames are parsed with parseMessage (protocol.h), the same grammar as
+   mygame. For each game it reports the shots and hit rate of each player,
+   the winner, the turn latency (start of a turn to the shot) and reply
+   latency (shot to result) when the lines have times, and the protocol
+   violations found. A summary with totals and latency percentiles follows.
+   Shots are checked against the board size each player announced with
+   GRID=<size> in READY (large event games), 10x10 if it announced none.
+
+   Compilation:
+     g++ -std=c++20 -O2 -o analyze analyze.cpp protocol.cpp -lpthread
+
+   Usage:
+     ./analyze [-j threads] [-s] [-v] file...
+       -j: worker threads (default one per core)
+       -s: summary only, no line per game
+       -v: print every violation with its file and line
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "board.h"
+#include "histogram.h"
+#include "protocol.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// Bytes read between releases of the pages behind the read position
+#define ANALYZE_RELEASE_BYTES (64 << 20)
+// Report text a worker collects before writing it out
+#define ANALYZE_OUTPUT_BYTES (1 << 20)
+// Ended streams a worker remembers, to catch frames sent after WIN
+#define ANALYZE_ENDED_STREAMS 65536
+
+enum Violation {
+    V_BAD_LINE,          // Missing stream, player or frame
+    V_MALFORMED,         // Frame that doesn't parse
+    V_EXTRA_PLAYER,      // A third player in a game
+    V_NOT_STARTED,       // START before READY, or a shot before START
+    V_OUT_OF_TURN,       // Shot by the player who isn't shooting
+    V_SHOT_PENDING,      // Shot while the previous one has no result
+    V_OFF_GRID,          // Shot outside the grid
+    V_REPEATED_SHOT,     // Same cell shot twice by the same player
+    V_UNEXPECTED_RESULT, // Result with no shot waiting, or from the shooter
+    V_AFTER_END,         // Shot or result after WIN
+    V_UNFINISHED,        // Capture ended mid game
+    V_COUNT
+};
+
+static const char *VIOLATION_NAMES[V_COUNT] = {
+    "bad line", "malformed frame", "extra player", "not started", "out of turn", "shot pending",
+    "off grid", "repeated shot", "unexpected result", "after end", "unfinished"
+};
+
+struct CaptureFile {
+    string path;
+    size_t size;
+};
+
+// One game in progress on a stream
+struct GameState {
+    int number = 1;              // Games seen on the stream, this one included
+    string player[2];
+    int players = 0;
+    int shooter = -1;            // Player to shoot, -1 before START
+    bool pending = false;        // Shot waiting for its result
+    bool over = false;
+    int winner = -1;
+    int shots[2] = {0, 0};
+    int hits[2] = {0, 0};
+    int grid[2] = {GRID_SIZE, GRID_SIZE};  // Board size from each player's READY (GRID=)
+    BitPlane shotAt[2];          // Cells shot on a classic board
+    unordered_set<uint64_t> sparseShotAt[2];  // and on a large event board
+    int64_t shotTime = -1;       // Time of the pending shot
+    int64_t turnStart = -1;      // When the current turn began
+    int64_t turnSum = 0, turnMax = 0;
+    int turns = 0;
+    int violations = 0;
+};
+
+// Lets the stream table be searched with a string_view
+struct TagHash {
+    using is_transparent = void;
+    size_t operator()(string_view s) const { return hash<string_view>()(s); }
+};
+
+// Totals kept by each worker and added up at the end
+struct Totals {
+    uint64_t lines = 0;          // Lines of this worker's streams
+    uint64_t games = 0;
+    uint64_t finished = 0;
+    uint64_t shots = 0;
+    uint64_t hits = 0;
+    uint64_t violations[V_COUNT] = {};
+    LatencyHistogram turn;
+    LatencyHistogram reply;
+
+    void merge(const Totals &other) {
+        lines += other.lines;
+        games += other.games;
+        finished += other.finished;
+        shots += other.shots;
+        hits += other.hits;
+        for (int v = 0; v < V_COUNT; v++) violations[v] += other.violations[v];
+        turn.merge(other.turn);
+        reply.merge(other.reply);
+    }
+};
+
+static mutex outputLock;
+
+class Worker {
+    private:
+        int shard, shards;
+        bool perGame, verbose;
+        unordered_map<string, GameState, TagHash, equal_to<>> streams;
+        deque<string> ended;         // Oldest first
+        string out;
+
+        // Current position, for -v
+        const char *fileName = "";
+        uint64_t lineNumber = 0;
+
+    public:
+        Totals totals;
+
+        Worker(int shardIndex, int shardCount, bool reportGames, bool reportViolations)
+            : shard(shardIndex), shards(shardCount), perGame(reportGames), verbose(reportViolations) {}
+
+        void run(const vector<CaptureFile> &files) {
+            for (const CaptureFile &file : files) scanFile(file);
+            // Whatever is left never finished
+            fileName = "end of capture";
+            lineNumber = 0;
+            for (auto &[tag, game] : streams) {
+                if (game.players == 0) continue;
+                violation(tag, game, V_UNFINISHED);
+                report(tag, game);
+            }
+            streams.clear();
+            ended.clear();
+            flush(true);
+        }
+
+    private:
+        void scanFile(const CaptureFile &file) {
+            if (file.size == 0) return;
+            int fd = open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return;
+            void *map = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (map == MAP_FAILED) return;
+            madvise(map, file.size, MADV_SEQUENTIAL);
+
+            const char *base = static_cast<const char *>(map);
+            const char *end = base + file.size;
+            const char *released = base;
+            fileName = file.path.c_str();
+            lineNumber = 0;
+            for (const char *p = base; p < end;) {
+                const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+                const char *lineEnd = nl ? nl : end;
+                lineNumber++;
+                onLine(string_view(p, lineEnd - p));
+                p = nl ? nl + 1 : end;
+
+                // Pages behind us won't be read again
+                if (p - released >= ANALYZE_RELEASE_BYTES) {
+                    size_t len = (p - released) & ~size_t(4095);
+                    madvise(const_cast<char *>(released), len, MADV_DONTNEED);
+                    released += len;
+                }
+            }
+            munmap(map, file.size);
+        }
+
+        // Split off the text up to the next space
+        static string_view nextToken(string_view &rest) {
+            size_t pos = rest.find(' ');
+            string_view token = rest.substr(0, pos);
+            rest = (pos == string_view::npos) ? string_view() : rest.substr(pos + 1);
+            return token;
+        }
+
+        // "[seconds.fraction]" to nanoseconds, -1 if it isn't one
+        static int64_t parseTime(string_view field) {
+            if (field.size() < 3 || field.front() != '[' || field.back() != ']') return -1;
+            int64_t seconds = 0, fraction = 0, scale = 1000000000;
+            size_t i = 1;
+            for (; i < field.size() - 1 && field[i] != '.'; i++) {
+                if (field[i] < '0' || field[i] > '9') return -1;
+                seconds = seconds * 10 + (field[i] - '0');
+            }
+            if (field[i] == '.') {
+                for (i++; i < field.size() - 1; i++) {
+                    if (field[i] < '0' || field[i] > '9') return -1;
+                    if (scale > 1) {
+                        scale /= 10;
+                        fraction += (field[i] - '0') * scale;
+                    }
+                }
+            }
+            return seconds * 1000000000 + fraction;
+        }
+
+        void onLine(string_view line) {
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty() || line.front() == '#') return;
+
+            string_view rest = line;
+            int64_t time = -1;
+            if (line.front() == '[') time = parseTime(nextToken(rest));
+            string_view tag = nextToken(rest);
+            if (TagHash()(tag) % shards != (size_t)shard) return;
+            totals.lines++;
+
+            string_view player = nextToken(rest);
+            auto it = streams.find(tag);
+            if (it == streams.end()) it = streams.emplace(string(tag), GameState()).first;
+            GameState &game = it->second;
+            if (player.empty() || rest.empty()) {
+                violation(tag, game, V_BAD_LINE);
+                return;
+            }
+            if (rest.starts_with("STATS")) return;
+
+            Message msg;
+            if (!parseMessage(rest, msg)) {
+                violation(tag, game, V_MALFORMED);
+                return;
+            }
+            onMessage(it->first, game, player, msg, time);
+        }
+
+        int playerIndex(const GameState &game, string_view player) const {
+            for (int i = 0; i < game.players; i++) {
+                if (game.player[i] == player) return i;
+            }
+            return -1;
+        }
+
+        // Apply one message to the stream's game
+        void onMessage(const string &tag, GameState &game, string_view player, const Message &msg, int64_t time) {
+            int idx = playerIndex(game, player);
+            switch (msg.type) {
+                case MSG_READY:
+                    // The next game on the stream
+                    if (game.over) {
+                        int number = game.number;
+                        game = GameState();
+                        game.number = number + 1;
+                    }
+                    // Players come back with READY after a dropped connection
+                    if (idx < 0) {
+                        if (game.players == 2) {
+                            violation(tag, game, V_EXTRA_PLAYER);
+                            return;
+                        }
+                        idx = game.players++;
+                        game.player[idx] = string(player);
+                    }
+                    {
+                        int size = capabilityValue(msg.caps, CAP_GRID);
+                        game.grid[idx] = size > 0 ? size : GRID_SIZE;
+                    }
+                    return;
+
+                case MSG_START:
+                    if (game.over) {
+                        violation(tag, game, V_AFTER_END);
+                        return;
+                    }
+                    if (idx < 0) {
+                        violation(tag, game, V_NOT_STARTED);
+                        return;
+                    }
+                    if (msg.position == 1 && game.shooter < 0) {
+                        game.shooter = idx;
+                        game.turnStart = time;
+                    }
+                    return;
+
+                case MSG_PLAY: {
+                    if (game.over) {
+                        violation(tag, game, V_AFTER_END);
+                        return;
+                    }
+                    if (idx < 0) {
+                        violation(tag, game, V_EXTRA_PLAYER);
+                        return;
+                    }
+                    if (game.shooter < 0) {
+                        violation(tag, game, V_NOT_STARTED);
+                        return;
+                    }
+                    if (idx != game.shooter) {
+                        violation(tag, game, V_OUT_OF_TURN);
+                        return;
+                    }
+                    if (game.pending) {
+                        violation(tag, game, V_SHOT_PENDING);
+                        return;
+                    }
+                    // The shot lands on the opponent's board
+                    int size = game.grid[1 - idx];
+                    if (msg.x >= size || msg.y >= size) {
+                        violation(tag, game, V_OFF_GRID);
+                        return;
+                    }
+                    if (size <= GRID_SIZE) {
+                        int cell = cellIndex(msg.y, msg.x);
+                        if (game.shotAt[idx].test(cell)) violation(tag, game, V_REPEATED_SHOT);
+                        game.shotAt[idx].set(cell);
+                    }
+                    else if (!game.sparseShotAt[idx].insert(uint64_t(msg.y) * size + msg.x).second) {
+                        violation(tag, game, V_REPEATED_SHOT);
+                    }
+                    game.shots[idx]++;
+                    game.pending = true;
+                    game.shotTime = time;
+                    if (time >= 0 && game.turnStart >= 0 && time >= game.turnStart) {
+                        int64_t turn = time - game.turnStart;
+                        game.turnSum += turn;
+                        game.turnMax = max(game.turnMax, turn);
+                        game.turns++;
+                        totals.turn.record(turn);
+                    }
+                    return;
+                }
+
+                case MSG_RESULT: {
+                    if (game.over) {
+                        violation(tag, game, V_AFTER_END);
+                        return;
+                    }
+                    if (!game.pending || idx < 0 || idx == game.shooter) {
+                        violation(tag, game, V_UNEXPECTED_RESULT);
+                        return;
+                    }
+                    game.pending = false;
+                    if (time >= 0 && game.shotTime >= 0 && time >= game.shotTime) totals.reply.record(time - game.shotTime);
+                    game.turnStart = time;
+                    if (isHit(msg.result)) game.hits[game.shooter]++;
+                    if (msg.result == RESULT_WIN) {
+                        game.over = true;
+                        game.winner = game.shooter;
+                        report(tag, game);
+                        endStream(tag, game);
+                        return;
+                    }
+                    if (msg.result == RESULT_MISS) game.shooter = 1 - game.shooter;
+                    return;
+                }
+
+                default:
+                    return;
+            }
+        }
+
+        // Keep only the game number of a stream that ended, and forget the
+        // oldest ended streams so a capture of many short streams stays small
+        void endStream(const string &tag, GameState &game) {
+            int number = game.number;
+            game = GameState();
+            game.number = number;
+            game.over = true;
+            ended.push_back(tag);
+            if (ended.size() > ANALYZE_ENDED_STREAMS) {
+                auto it = streams.find(ended.front());
+                if (it != streams.end() && it->second.over) streams.erase(it);
+                ended.pop_front();
+            }
+        }
+
+        void violation(string_view tag, GameState &game, Violation kind) {
+            game.violations++;
+            totals.violations[kind]++;
+            if (verbose) {
+                out += fileName;
+                if (lineNumber > 0) {
+                    out += ':';
+                    out += to_string(lineNumber);
+                }
+                out += ": ";
+                out += tag;
+                out += ": ";
+                out += VIOLATION_NAMES[kind];
+                out += '\n';
+                flush(false);
+            }
+        }
+
+        // Add up a game that ended (or never will) and print its line
+        void report(string_view tag, const GameState &game) {
+            totals.games++;
+            if (game.over) totals.finished++;
+            for (int i = 0; i < game.players; i++) {
+                totals.shots += game.shots[i];
+                totals.hits += game.hits[i];
+            }
+            if (!perGame) return;
+
+            char buf[128];
+            out += tag;
+            out += '#';
+            out += to_string(game.number);
+            out += ':';
+            for (int i = 0; i < game.players; i++) {
+                snprintf(buf, sizeof(buf), " %d shots %d hits (%.1f%%),", game.shots[i], game.hits[i],
+                         game.shots[i] ? 100.0 * game.hits[i] / game.shots[i] : 0.0);
+                out += ' ';
+                out += game.player[i];
+                out += buf;
+            }
+            out += game.over ? " winner " + game.player[game.winner] : string(" unfinished");
+            if (game.turns > 0) {
+                snprintf(buf, sizeof(buf), ", turn mean %.1f max %.1f us", game.turnSum / 1e3 / game.turns, game.turnMax / 1e3);
+                out += buf;
+            }
+            snprintf(buf, sizeof(buf), ", %d violations\n", game.violations);
+            out += buf;
+            flush(false);
+        }
+
+        void flush(bool force) {
+            if (out.empty() || (!force && out.size() < ANALYZE_OUTPUT_BYTES)) return;
+            lock_guard<mutex> lock(outputLock);
+            fwrite(out.data(), 1, out.size(), stdout);
+            out.clear();
+        }
+};
+
+static void printHistogram(const char *title, const LatencyHistogram &h) {
+    if (h.count() == 0) return;
+    printf("%-16s n=%-9llu mean %8.1f  p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f us\n",
+           title, (unsigned long long)h.count(), h.mean() / 1e3, h.percentile(0.5) / 1e3,
+           h.percentile(0.9) / 1e3, h.percentile(0.99) / 1e3, h.max() / 1e3);
+}
+
+int main(int argc, char *argv[])
+{
+    int numThreads = max(1u, thread::hardware_concurrency());
+    bool perGame = true;
+    bool verbose = false;
+    vector<CaptureFile> files;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-s") perGame = false;
+        else if (arg == "-v") verbose = true;
+        else if (arg == "-j" && i + 1 < argc) numThreads = max(1, stoi(argv[++i]));
+        else {
+            struct stat st;
+            if (stat(arg.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+                cerr << "Can't read " << arg << endl;
+                return 1;
+            }
+            files.push_back({arg, (size_t)st.st_size});
+        }
+    }
+    if (files.empty()) {
+        cerr << "Usage: ./analyze [-j threads] [-s] [-v] file..." << endl;
+        return 1;
+    }
+
+    uint64_t bytes = 0;
+    for (const CaptureFile &file : files) bytes += file.size;
+
+    Clock::time_point started = Clock::now();
+    vector<unique_ptr<Worker>> workers;
+    vector<thread> threads;
+    for (int t = 0; t < numThreads; t++) workers.push_back(make_unique<Worker>(t, numThreads, perGame, verbose));
+    for (int t = 0; t < numThreads; t++) threads.emplace_back([&, t] { workers[t]->run(files); });
+    for (thread &t : threads) t.join();
+    double elapsed = chrono::duration<double>(Clock::now() - started).count();
+
+    Totals totals;
+    for (auto &worker : workers) totals.merge(worker->totals);
+    uint64_t violations = 0;
+    for (int v = 0; v < V_COUNT; v++) violations += totals.violations[v];
+
+    printf("%zu files, %.1f MB, %llu lines in %.2f s: %.1f MB/s with %d threads\n", files.size(), bytes / 1e6,
+           (unsigned long long)totals.lines, elapsed, bytes / 1e6 / elapsed, numThreads);
+    printf("%llu games, %llu finished, %llu shots, %.1f%% hits, %.1f shots per game\n",
+           (unsigned long long)totals.games, (unsigned long long)totals.finished, (unsigned long long)totals.shots,
+           totals.shots ? 100.0 * totals.hits / totals.shots : 0.0,
+           totals.games ? double(totals.shots) / totals.games : 0.0);
+    printHistogram("turn latency", totals.turn);
+    printHistogram("reply latency", totals.reply);
+    printf("%llu violations\n", (unsigned long long)violations);
+    for (int v = 0; v < V_COUNT; v++) {
+        if (totals.violations[v]) printf("  %-18s %llu\n", VIOLATION_NAMES[v], (unsigned long long)totals.violations[v]);
+    }
+    return 0;
+}
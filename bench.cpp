@@ -0,0 +1,464 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Benchmarks for the fleet, board, sparse board, parser, render, journal, trace, spectator feed and keypad hot paths
+   Authors: Paolo Saliba and Brayton Alvarez
+
+   Compilation (no wiringPi needed):
+     g++ -std=c++20 -O2 -o bench bench.cpp keypad.cpp gpioMock.cpp gpioMmap.cpp protocol.cpp render.cpp journal.cpp trace.cpp spectator.cpp -lpthread -lrt
+
+   Usage:
+     ./bench [-j] [-t seconds] [-f filter] [-l label]
+       -j: print the results as JSON instead of a table
+       -t: time spent on each benchmark (default 0.5)
+       -f: only run benchmarks whose name contains filter
+       -l: label stored in the JSON output, e.g. the commit being measured
+
+   Compare two commits with:
+     ./bench -j -l $(git rev-parse --short HEAD) > before.json
+*/
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "genFleet.h"
+#include "board.h"
+#include "fleetGenerator.h"
+#include "gameRules.h"
+#include "keypad.h"
+#include "gpioMock.h"
+#include "gpioMmap.h"
+#include "journal.h"
+#include "protocol.h"
+#include "render.h"
+#include "sparseBoard.h"
+#include "trace.h"
+#include "spectator.h"
+
+using namespace std;
+
+// Keep the compiler from dropping work whose result is unused.
+static volatile unsigned long sink;
+
+static double benchSeconds = 0.5;
+static string filter;
+
+struct BenchResult {
+    string name;
+    double value;
+    string unit;
+};
+static vector<BenchResult> results;
+
+// Run fn repeatedly for about benchSeconds and return calls per second.
+template <typename Fn>
+double rate(Fn fn) {
+    using clock = chrono::steady_clock;
+    unsigned long calls = 0;
+    auto start = clock::now();
+    auto deadline = start + chrono::duration<double>(benchSeconds);
+    while (clock::now() < deadline) {
+        for (int i = 0; i < 64; i++) fn();
+        calls += 64;
+    }
+    double elapsed = chrono::duration<double>(clock::now() - start).count();
+    return calls / elapsed;
+}
+
+static bool selected(const string &name) {
+    return filter.empty() || name.find(filter) != string::npos;
+}
+
+// Measure fn, which does opsPerCall operations, and record ops per second
+template <typename Fn>
+void bench(const string &name, const string &unit, double opsPerCall, Fn fn) {
+    if (!selected(name)) return;
+    results.push_back({name, rate(fn) * opsPerCall, unit});
+}
+
+// Discards everything written through a stream
+class NullBuffer : public streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        streamsize xsputn(const char *, streamsize n) override { return n; }
+};
+
+static int colPins[MAXCOL] = {21, 20, 16};
+static int rowPins[MAXROW] = {19, 13, 6, 5};
+
+static void fleetBenchmarks() {
+    bench("fleet.autogen_string", "layouts/s", 1, [] {
+        string map[GRID_SIZE][GRID_SIZE];
+        resetFleet(map);
+        autogenFleet(map, ClassicGame::fleet);
+        sink = sink + map[0][0].size();
+    });
+
+    bench("fleet.autogen_board", "layouts/s", 1, [] {
+        Board board;
+        autogenFleet(board, ClassicGame::fleet);
+        sink = sink + board.ship.w[0];
+    });
+
+    FleetGenerator generator(1);
+    bench("fleet.generator_rejection", "layouts/s", 1, [&] {
+        Board board;
+        generator.generateRejection(board, ClassicGame::fleet);
+        sink = sink + board.ship.w[0];
+    });
+
+    bench("fleet.generator_masks", "layouts/s", 1, [&] {
+        Board board;
+        generator.generate(board, ClassicGame::fleet);
+        sink = sink + board.ship.w[0];
+    });
+
+    bench("rng.bounded_rand", "calls/s", 16, [] {
+        for (int i = 0; i < 16; i++) sink = sink + bounded_rand(9);
+    });
+
+    FastRng rng(1);
+    bench("rng.fastrng_bounded", "calls/s", 16, [&] {
+        for (int i = 0; i < 16; i++) sink = sink + rng.bounded(9);
+    });
+}
+
+static void boardBenchmarks() {
+    string grid[GRID_SIZE][GRID_SIZE];
+    resetFleet(grid);
+    autogenFleet(grid, ClassicGame::fleet);
+    Board board;
+    FleetGenerator generator(2);
+    generator.generate(board, ClassicGame::fleet);
+
+    // Worst case for the check: nothing sunk until the last cell is looked at
+    bench("board.all_ships_sunk_string", "calls/s", 1, [&] { sink = sink + allShipsSunk(grid); });
+    bench("board.all_ships_sunk_board", "calls/s", 1, [&] { sink = sink + allShipsSunk(board); });
+
+    // Every cell shot once, from a fresh copy of the layout (the copy is
+    // part of the time, which is most of it for the string map)
+    bench("board.resolve_shot_string", "shots/s", GRID_SIZE * GRID_SIZE, [&] {
+        string copy[GRID_SIZE][GRID_SIZE];
+        for (int r = 0; r < GRID_SIZE; r++) {
+            for (int c = 0; c < GRID_SIZE; c++) copy[r][c] = grid[r][c];
+        }
+        for (int y = 0; y < GRID_SIZE; y++) {
+            for (int x = 0; x < GRID_SIZE; x++) sink = sink + resolveShot(copy, x, y);
+        }
+    });
+    bench("board.resolve_shot_board", "shots/s", GRID_SIZE * GRID_SIZE, [&] {
+        Board copy = board;
+        for (int y = 0; y < GRID_SIZE; y++) {
+            for (int x = 0; x < GRID_SIZE; x++) sink = sink + resolveShot(copy, x, y);
+        }
+    });
+}
+
+// A large event board: 3000 ships on a million by million grid
+static void sparseBenchmarks() {
+    FleetGenerator generator(4);
+    vector<unsigned short> fleet = sparseFleet(3000);
+    SparseBoard board(SPARSE_MAX_SIZE);
+    bench("sparse.generate", "layouts/s", 1, [&] {
+        generator.generate(board, fleet);
+        sink = sink + board.ships.size();
+    });
+
+    // Shots at the first cell of every ship (a lookup that finds one)
+    // and at random cells (almost all water), on a fresh copy
+    vector<pair<int, int>> shots;
+    for (const SparseShip &ship : board.ships) shots.push_back({ship.col, ship.row});
+    for (int i = 0; i < 3000; i++) {
+        shots.push_back({int(generator.engine().bounded(SPARSE_MAX_SIZE - 1)),
+                         int(generator.engine().bounded(SPARSE_MAX_SIZE - 1))});
+    }
+    bench("sparse.resolve_shot", "shots/s", shots.size(), [&] {
+        SparseBoard copy = board;
+        for (auto [x, y] : shots) sink = sink + resolveShot(copy, x, y);
+    });
+    bench("sparse.ship_at", "lookups/s", shots.size(), [&] {
+        for (auto [x, y] : shots) sink = sink + board.shipAt(y, x);
+    });
+}
+
+static void parserBenchmarks() {
+    // A typical stream of messages, delivered in 37 byte pieces so frames
+    // are split and coalesced the way TCP may deliver them
+    string stream;
+    for (int i = 0; i < 100; i++) {
+        stream += "PLAY," + to_string(i % 10) + "," + to_string(i / 10) + "\r\n";
+        stream += (i % 3) ? "PLAY,RESULT,MISS\r\n" : "PLAY,RESULT,HIT\r\n";
+    }
+    const int streamMessages = 200;
+
+    bench("parse.frame_reader", "messages/s", streamMessages, [&] {
+        FrameReader reader;
+        string_view frame;
+        Message msg;
+        for (size_t pos = 0; pos < stream.size(); pos += 37) {
+            reader.feed(stream.data() + pos, min<size_t>(37, stream.size() - pos));
+            while (reader.next(frame)) {
+                parseMessage(frame, msg);
+                sink = sink + msg.x + msg.result;
+            }
+        }
+    });
+
+    // The same stream as binary records
+    string records;
+    for (int i = 0; i < 100; i++) {
+        char rec[BIN_RECORD_SIZE];
+        records.append(rec, encodePlay(rec, i % 10, i / 10));
+        records.append(rec, encodeResult(rec, (i % 3) ? RESULT_MISS : RESULT_HIT));
+    }
+
+    bench("parse.binary_records", "messages/s", streamMessages, [&] {
+        FrameReader reader;
+        Message msg;
+        for (size_t pos = 0; pos < records.size(); pos += 37) {
+            reader.feed(records.data() + pos, min<size_t>(37, records.size() - pos));
+            while (nextMessage(reader, true, msg)) sink = sink + msg.x + msg.result;
+        }
+    });
+
+    bench("parse.get_from_buffer", "messages/s", streamMessages, [&] {
+        string rest = stream;
+        while (!rest.empty()) {
+            string line = getFromBuffer(rest, "\r\n");
+            string command = getFromBuffer(line, ",");
+            string second = getFromBuffer(line, ",");
+            if (second == "RESULT") sink = sink + getFromBuffer(line, "\r").size();
+            else sink = sink + stoi(second) + stoi(getFromBuffer(line, "\r"));
+        }
+    });
+}
+
+// A whole game journaled (two of its records are synced to the file) and
+// the same journal replayed, in a scratch file
+static void journalBenchmarks() {
+    const char *path = "/tmp/bench.journal";
+    Board board, opp;
+    FleetGenerator generator(4);
+    generator.generate(board, ClassicGame::fleet);
+    {
+        GameJournal journal(path);
+        bench("journal.record_game", "records/s", 2 * GRID_SIZE * GRID_SIZE + FLEET_COUNT + 3, [&] {
+            journal.begin(board);
+            journal.start(1);
+            for (int y = 0; y < GRID_SIZE; y++) {
+                for (int x = 0; x < GRID_SIZE; x++) {
+                    journal.shot(x, y);
+                    journal.result(RESULT_MISS, 0);
+                }
+            }
+            journal.end();
+        });
+
+        journal.begin(board);
+        journal.start(1);
+        for (int i = 0; i < GRID_SIZE * GRID_SIZE; i++) {
+            journal.shot(i % GRID_SIZE, i / GRID_SIZE);
+            journal.result(RESULT_MISS, 0);
+        }
+        bench("journal.replay", "records/s", journal.size(), [&] {
+            sink = sink + journal.replay(board, opp).records;
+        });
+    }
+    unlink(path);
+}
+
+// A timed sample (two clock reads and the ring store) as the client takes
+// it, with the rings collected into the histograms every 64 samples
+static void traceBenchmarks() {
+    auto tracer = make_unique<Tracer>();
+    TraceRing *ring = tracer->attach();
+    bench("trace.record", "samples/s", 64, [&] {
+        for (int i = 0; i < 64; i++) ring->since(TraceSpan(i % TRACE_SPANS), traceNow());
+        tracer->collect();
+    });
+}
+
+// One shot as the client publishes it: the event, then the snapshot
+static void spectatorBenchmarks() {
+    auto feed = make_unique<SpectatorFeed>("battleship.bench." + to_string(getpid()), "bench", GRID_SIZE, FLEET_COUNT);
+    Board mine, opp;
+    FleetGenerator generator(5);
+    generator.generate(mine, ClassicGame::fleet);
+    int shot = 0;
+    bench("spectator.publish_shot", "shots/s", 1, [&] {
+        int x = shot % GRID_SIZE, y = (shot / GRID_SIZE) % GRID_SIZE;
+        shot++;
+        feed->shot(false, x, y, mine.isShip(y, x) ? RESULT_HIT : RESULT_MISS, 0);
+        feed->publish(SPECTATE_THEIR_TURN, mine, opp);
+    });
+}
+
+// Grids are printed into a null sink: cout goes to a discarding buffer
+// and file descriptor 1 to /dev/null while these run.
+static void renderBenchmarks() {
+    string myGrid[GRID_SIZE][GRID_SIZE], oppGrid[GRID_SIZE][GRID_SIZE];
+    resetFleet(myGrid);
+    resetFleet(oppGrid);
+    autogenFleet(myGrid, ClassicGame::fleet);
+    Board mine, opp;
+    FleetGenerator generator(3);
+    generator.generate(mine, ClassicGame::fleet);
+    for (int i = 0; i < 30; i++) {
+        int x = generator.engine().bounded(GRID_SIZE - 1), y = generator.engine().bounded(GRID_SIZE - 1);
+        ShotResult result = resolveShot(myGrid, x, y);
+        resolveShot(mine, x, y);
+        recordResult(opp, x, y, result);
+        oppGrid[y][x] = (result == RESULT_MISS) ? "o" : "X";
+    }
+
+    cout.flush();
+    NullBuffer nullBuffer;
+    streambuf *saved = cout.rdbuf(&nullBuffer);
+    int savedFd = dup(STDOUT_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+
+    bench("render.player_grid_string", "grids/s", 1, [&] { printPlayerGrid(myGrid); });
+    bench("render.opponent_grid_string", "grids/s", 1, [&] { printOpponentGrid(oppGrid); });
+    bench("render.player_grid_board", "grids/s", 1, [&] { printPlayerGrid(mine); });
+    bench("render.opponent_grid_board", "grids/s", 1, [&] { printOpponentGrid(opp); });
+    bench("render.display_grids_string", "frames/s", 1, [&] { displayGrids(myGrid, oppGrid); });
+
+    // The renderers go out of scope before stdout is restored, so the diff
+    // renderer's terminal reset goes to the sink as well
+    if (selected("render.display_grids_full") || selected("render.display_grids_diff")) {
+        GridRenderer full(STDOUT_FILENO, RENDER_FULL);
+        bench("render.display_grids_full", "frames/s", 1, [&] { full.draw(mine, opp); });
+
+        // One cell changes on each board between frames, as after a shot
+        GridRenderer diff(STDOUT_FILENO, RENDER_DIFF);
+        diff.draw(mine, opp);
+        int cell = 0;
+        auto shoot = [&] {
+            int idx = cell++ % (GRID_SIZE * GRID_SIZE);
+            mine.miss.w[idx >> 6] ^= uint64_t(1) << (idx & 63);
+            opp.miss.w[idx >> 6] ^= uint64_t(1) << (idx & 63);
+        };
+        bench("render.display_grids_diff", "frames/s", 1, [&] {
+            shoot();
+            diff.draw(mine, opp);
+        });
+
+        results.push_back({"render.display_grids_full_bytes", double(full.build(mine, opp).size()), "bytes"});
+        shoot();
+        results.push_back({"render.display_grids_diff_bytes", double(diff.build(mine, opp).size()), "bytes"});
+    }
+
+    dup2(savedFd, STDOUT_FILENO);
+    close(savedFd);
+    close(devNull);
+    cout.rdbuf(saved);
+}
+
+static void keypadBenchmarks() {
+    // Full matrix scan with key "5" held, pin by pin through the mock
+    MockGpio mock;
+    mock.press(rowPins[1], colPins[1]);
+    Keypad mockPad(colPins, rowPins, mock);
+    bench("keypad.scan_mock", "scans/s", 1, [&] { sink = sink + mockPad.scan(); });
+    mock.release(rowPins[1], colPins[1]);
+
+    // Same scan through the register map, backed by a temporary file.
+    // The level register is set up so row 1 is low (the fake block doesn't
+    // follow the driven column, so all of row 1 reads down).
+    char path[] = "/tmp/gpioblockXXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0 && selected("keypad.scan_register_map")) {
+        close(fd);
+        MmapGpio regs(path);
+        regs.registers()[13] = ((1u << rowPins[0]) | (1u << rowPins[2]) | (1u << rowPins[3])) | (1u << colPins[1]);
+        Keypad mmapPad(colPins, rowPins, regs);
+        bench("keypad.scan_register_map", "scans/s", 1, [&] { sink = sink + mmapPad.scan(); });
+    }
+    if (fd >= 0) unlink(path);
+
+    KeyQueue<KEY_QUEUE_SIZE> queue;
+    bench("keypad.queue_push_pop", "events/s", 1, [&] {
+        KeyEvent event{};
+        queue.push({'5', chrono::steady_clock::now()});
+        queue.try_pop(event);
+        sink = sink + event.key;
+    });
+
+    // Debouncing a scan with two keys held and a bouncing third
+    bench("keypad.debounce", "scans/s", 2, [&] {
+        sink = sink + mockPad.debounce_keys(0x011) + mockPad.debounce_keys(0x111);
+    });
+
+    // Press to event in the consumer, through the edge-triggered scanner
+    // and the default debounce. Releases in between are skipped.
+    if (selected("keypad.event_latency_mock")) {
+        Keypad edgePad(colPins, rowPins, mock, true);
+        edgePad.run();
+        this_thread::sleep_for(50ms);
+        const int presses = 20;
+        double total = 0;
+        for (int i = 0; i < presses; i++) {
+            int r = i % MAXROW, c = i % MAXCOL;
+            auto pressed = chrono::steady_clock::now();
+            mock.press(rowPins[r], colPins[c]);
+            KeyEvent event;
+            bool got = edgePad.try_get_event(event, 500ms);
+            while (got && !event.pressed) got = edgePad.try_get_event(event, 500ms);
+            if (got) {
+                total += chrono::duration<double, micro>(chrono::steady_clock::now() - pressed).count();
+            }
+            this_thread::sleep_for(25ms);
+            mock.release(rowPins[r], colPins[c]);
+            this_thread::sleep_for(45ms);
+        }
+        edgePad.stop();
+        results.push_back({"keypad.event_latency_mock", total / presses, "us"});
+    }
+}
+
+static void printJson(const string &label) {
+    printf("{\n  \"label\": \"%s\",\n  \"seconds_per_benchmark\": %g,\n  \"results\": [\n", label.c_str(), benchSeconds);
+    for (size_t i = 0; i < results.size(); i++) {
+        printf("    {\"name\": \"%s\", \"value\": %.6g, \"unit\": \"%s\"}%s\n", results[i].name.c_str(),
+               results[i].value, results[i].unit.c_str(), i + 1 < results.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
+
+static void printTable() {
+    for (const BenchResult &r : results) {
+        printf("%-36s %14.6g %s\n", r.name.c_str(), r.value, r.unit.c_str());
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool json = false;
+    string label;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-j") json = true;
+        else if (i + 1 < argc) {
+            if (arg == "-t") benchSeconds = stod(argv[++i]);
+            else if (arg == "-f") filter = argv[++i];
+            else if (arg == "-l") label = argv[++i];
+        }
+    }
+
+    fleetBenchmarks();
+    boardBenchmarks();
+    sparseBenchmarks();
+    parserBenchmarks();
+    journalBenchmarks();
+    traceBenchmarks();
+    spectatorBenchmarks();
+    renderBenchmarks();
+    keypadBenchmarks();
+
+    if (json) printJson(label);
+    else printTable();
+    return 0;
+}
@@ -0,0 +1,314 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Packed bitboard game state for a Battleship grid
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <bit>       // popcount
+#include <cstdint>
+#include "gameConfig.h"
+#include "genFleet.h"
+
+// Number of 64-bit words needed to hold one bit per cell of the classic grid
+#define BOARD_WORDS ((GRID_SIZE * GRID_SIZE + 63) / 64)
+
+using namespace std;
+
+// Index of a cell inside a bit plane (row major).
+template <int Size = GRID_SIZE>
+inline constexpr int cellIndex(int row, int col) {
+    return row * Size + col;
+}
+
+// One bit per cell of a grid of Cells cells. The word count is a constant
+// of the type, so the loops below unroll to straight-line code.
+template <int Cells>
+struct BasicBitPlane {
+    static constexpr int words = (Cells + 63) / 64;
+    uint64_t w[words] = {};
+
+    bool test(int idx) const { return (w[idx >> 6] >> (idx & 63)) & 1; }
+    void set(int idx)        { w[idx >> 6] |= uint64_t(1) << (idx & 63); }
+    void clear()             { for (int i = 0; i < words; i++) w[i] = 0; }
+
+    // Number of cells set in the plane.
+    int count() const {
+        int n = 0;
+        for (int i = 0; i < words; i++) n += popcount(w[i]);
+        return n;
+    }
+
+    bool any() const {
+        uint64_t acc = 0;
+        for (int i = 0; i < words; i++) acc |= w[i];
+        return acc != 0;
+    }
+
+    // True if this plane and other share at least one cell.
+    bool intersects(const BasicBitPlane &other) const {
+        uint64_t acc = 0;
+        for (int i = 0; i < words; i++) acc |= w[i] & other.w[i];
+        return acc != 0;
+    }
+
+    BasicBitPlane &operator|=(const BasicBitPlane &other) {
+        for (int i = 0; i < words; i++) w[i] |= other.w[i];
+        return *this;
+    }
+
+    BasicBitPlane &operator&=(const BasicBitPlane &other) {
+        for (int i = 0; i < words; i++) w[i] &= other.w[i];
+        return *this;
+    }
+
+    // Cells set in this plane but not in other.
+    BasicBitPlane andNot(const BasicBitPlane &other) const {
+        BasicBitPlane r;
+        for (int i = 0; i < words; i++) r.w[i] = w[i] & ~other.w[i];
+        return r;
+    }
+
+    // Every cell of the grid set
+    static BasicBitPlane full() {
+        BasicBitPlane r;
+        for (int i = 0; i < words; i++) r.w[i] = ~uint64_t(0);
+        if (Cells % 64) r.w[words - 1] = (uint64_t(1) << (Cells % 64)) - 1;
+        return r;
+    }
+};
+
+template <int Cells>
+inline BasicBitPlane<Cells> operator|(BasicBitPlane<Cells> a, const BasicBitPlane<Cells> &b) { return a |= b; }
+template <int Cells>
+inline BasicBitPlane<Cells> operator&(BasicBitPlane<Cells> a, const BasicBitPlane<Cells> &b) { return a &= b; }
+
+using BitPlane = BasicBitPlane<GRID_SIZE * GRID_SIZE>;
+
+// Game state for one grid, stored as bit planes instead of a string per cell.
+// On your own board the ship planes hold the fleet; on the opponent view only
+// the hit and miss planes are used.
+// Damage is counted as hits land, per ship and in total, so finding out
+// whether a ship or the whole fleet is sunk doesn't rescan the grid.
+template <typename Config>
+struct BasicBoard {
+    static constexpr int size = Config::gridSize;
+    static constexpr int cells = Config::cells;
+    static constexpr int fleetCount = Config::fleetCount;
+    using Plane = BasicBitPlane<cells>;
+
+    Plane ship;                      // Any ship cell
+    Plane hit;                       // Cells shot and hit
+    Plane miss;                      // Cells shot and missed
+    Plane shipId[fleetCount];        // Cells of each ship in the fleet
+    signed char cellShip[cells];     // Ship index per cell, -1 for water
+    unsigned char shipSize[fleetCount];           // Cells of each ship
+    unsigned char shipLeft[fleetCount];           // Cells of each ship not hit yet
+    int cellsLeft;                                // Ship cells not hit yet
+
+    BasicBoard() { reset(); }
+
+    void reset() {
+        ship.clear();
+        hit.clear();
+        miss.clear();
+        for (int i = 0; i < fleetCount; i++) {
+            shipId[i].clear();
+            shipSize[i] = shipLeft[i] = 0;
+        }
+        for (int i = 0; i < cells; i++) cellShip[i] = -1;
+        cellsLeft = 0;
+    }
+
+    static constexpr int cell(int row, int col) { return cellIndex<size>(row, col); }
+
+    bool isShip(int row, int col) const { return ship.test(cell(row, col)); }
+    bool isHit(int row, int col) const  { return hit.test(cell(row, col)); }
+    bool isMiss(int row, int col) const { return miss.test(cell(row, col)); }
+
+    // True if the cell has already been shot at.
+    bool isShot(int row, int col) const {
+        int idx = cell(row, col);
+        return hit.test(idx) || miss.test(idx);
+    }
+
+    // Index of the ship covering the cell, or -1 for open water.
+    int shipAt(int row, int col) const { return cellShip[cell(row, col)]; }
+
+    // Add a ship covering the cells in mask.
+    void placeShip(int ship_idx, const Plane &mask) {
+        ship |= mask;
+        shipId[ship_idx] |= mask;
+        for (int w = 0; w < Plane::words; w++) {
+            for (uint64_t bits = mask.w[w]; bits; bits &= bits - 1) {
+                cellShip[w * 64 + countr_zero(bits)] = ship_idx;
+            }
+        }
+        int cells = mask.count();
+        shipSize[ship_idx] += cells;
+        shipLeft[ship_idx] += cells;
+        cellsLeft += cells;
+    }
+
+    // Mark the cell hit. Returns the index of the ship hit for the first
+    // time at this cell, or -1 (water, or a cell that was already hit).
+    int markHit(int row, int col) {
+        int idx = cell(row, col);
+        if (hit.test(idx)) return -1;
+        hit.set(idx);
+        int s = cellShip[idx];
+        if (s >= 0) {
+            shipLeft[s]--;
+            cellsLeft--;
+        }
+        return s;
+    }
+
+    void markMiss(int row, int col) { miss.set(cell(row, col)); }
+
+    bool isSunk(int ship_idx) const { return shipSize[ship_idx] > 0 && shipLeft[ship_idx] == 0; }
+
+    // Ship cells that have not been hit yet.
+    int remaining() const { return cellsLeft; }
+
+    bool allShipsSunk() const { return cellsLeft == 0; }
+};
+
+using Board = BasicBoard<ClassicGame>;
+
+// Mask for a ship of ship_size cells starting at (row, col).
+template <int Size = GRID_SIZE>
+inline BasicBitPlane<Size * Size> shipMask(int row, int col, int ship_size, bool isHorizontal) {
+    BasicBitPlane<Size * Size> m;
+    for (int i = 0; i < ship_size; i++) {
+        m.set(isHorizontal ? cellIndex<Size>(row, col + i) : cellIndex<Size>(row + i, col));
+    }
+    return m;
+}
+
+// Mask for the ship plus every neighbouring cell, clipped to the grid.
+template <int Size = GRID_SIZE>
+inline BasicBitPlane<Size * Size> haloMask(int row, int col, int ship_size, bool isHorizontal) {
+    int lo_row = (row > 0 ? row - 1 : 0);
+    int lo_col = (col > 0 ? col - 1 : 0);
+    int hi_row = min(isHorizontal ? row + 1 : row + ship_size, Size - 1);
+    int hi_col = min(isHorizontal ? col + ship_size : col + 1, Size - 1);
+    BasicBitPlane<Size * Size> m;
+    for (int r = lo_row; r <= hi_row; r++) {
+        for (int c = lo_col; c <= hi_col; c++) {
+            m.set(cellIndex<Size>(r, c));
+        }
+    }
+    return m;
+}
+
+// Resets the board by clearing every plane.
+template <typename Config>
+inline void resetFleet(BasicBoard<Config> &board) {
+    board.reset();
+}
+
+// Check if all ships on the board are sunk.
+template <typename Config>
+inline bool allShipsSunk(const BasicBoard<Config> &board) {
+    return board.allShipsSunk();
+}
+
+// Characters before the first cell of a row: the row number, padded to the
+// width of the largest one, and "| "
+inline constexpr int rowLabelWidth(int size) {
+    return size > 10 ? 2 : 1;
+}
+
+// Column numbers and the rule under them, as printed by printFleet.
+// Past 9 only the last digit of a column number is shown.
+template <int Size = GRID_SIZE>
+inline void appendFleetHeader(string &out) {
+    out.append(rowLabelWidth(Size) + 2, ' ');
+    for (unsigned short i = 0; i < Size; i++) {
+        out += to_string(i % 10);
+        out += ' ';
+    }
+    out += '\n';
+    out.append(rowLabelWidth(Size) + 2, '_');
+    for (unsigned short i = 0; i < Size; i++) {
+        out += "__";
+    }
+    out += '\n';
+}
+
+// Row number right aligned to the row label width
+template <int Size = GRID_SIZE>
+inline void appendRowLabel(string &out, int row) {
+    if (rowLabelWidth(Size) == 2 && row < 10) out += ' ';
+    out += to_string(row);
+    out += "| ";
+}
+
+// Prints a simplified view of the board using a solid block for ship cells.
+// The grid is built in one string and written with a single stream call.
+template <typename Config>
+inline void printFleet(const BasicBoard<Config> &board) {
+    constexpr int size = Config::gridSize;
+    string out;
+    out.reserve(512);
+    appendFleetHeader<size>(out);
+    for (unsigned short row = 0; row < size; row++) {
+        appendRowLabel<size>(out, row);
+        for (unsigned short col = 0; col < size; col++) {
+            out += (board.isShip(row, col) ? "\u25A0 " : "  ");
+        }
+        out += '\n';
+    }
+    cout << out << flush;
+}
+
+// Prints a detailed view of the board: ship index, "X" for hits and "o" for misses.
+template <typename Config>
+inline void printFleetDetailed(const BasicBoard<Config> &board) {
+    constexpr int size = Config::gridSize;
+    string out;
+    out.reserve(512);
+    appendFleetHeader<size>(out);
+    for (unsigned short row = 0; row < size; row++) {
+        appendRowLabel<size>(out, row);
+        for (unsigned short col = 0; col < size; col++) {
+            if (board.isHit(row, col))       out += 'X';
+            else if (board.isMiss(row, col)) out += 'o';
+            else if (board.isShip(row, col)) out += char('0' + board.shipAt(row, col));
+            else                             out += ' ';
+            out += ' ';
+        }
+        out += '\n';
+    }
+    cout << out << flush;
+}
+
+// Automatically generates a fleet on the board based on the fleet sizes
+// provided (by default the configuration's own fleet). Same placement rules
+// as the string version: ships never touch, not even diagonally.
+template <typename Config>
+inline void autogenFleet(BasicBoard<Config> &board, const unsigned short(& fleet)[Config::fleetCount] = Config::fleet) {
+    constexpr int size = Config::gridSize;
+    typename BasicBoard<Config>::Plane blocked;    // Ship cells plus their halo
+    for (unsigned short ship_idx = 0; ship_idx < Config::fleetCount; ship_idx++) {
+        unsigned short ship_size = fleet[ship_idx];
+        while (true) {
+            bool isHorizontal = bounded_rand(1);
+            unsigned short max_row = isHorizontal ? size - 1 : size - ship_size - 1;
+            unsigned short max_col = isHorizontal ? size - ship_size - 1 : size - 1;
+            unsigned short start_row = bounded_rand(max_row);
+            unsigned short start_col = bounded_rand(max_col);
+
+            auto mask = shipMask<size>(start_row, start_col, ship_size, isHorizontal);
+            if (mask.intersects(blocked)) {
+                continue;
+            }
+            board.placeShip(ship_idx, mask);
+            blocked |= haloMask<size>(start_row, start_col, ship_size, isHorizontal);
+            break;
+        }
+    }
+}
+
+#endif // BOARD_H
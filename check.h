@@ -0,0 +1,30 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Minimal check macro for the test programs
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+
+#include <iostream>
+
+#pragma once  // include only once
+
+// Checks run and failed so far in this test program
+inline int checksRun = 0;
+inline int checksFailed = 0;
+
+// Record one check, printing the condition and where it is if it fails
+inline bool checkCondition(bool ok, const char *text, const char *file, int line) {
+    checksRun++;
+    if (!ok) {
+        checksFailed++;
+        std::cerr << file << ":" << line << ": check failed: " << text << std::endl;
+    }
+    return ok;
+}
+
+#define CHECK(condition) checkCondition(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+// Print the totals; main returns this so a failed check fails the run
+inline int checkResult(const char *name) {
+    std::cout << name << ": " << checksRun - checksFailed << "/" << checksRun << " checks passed" << std::endl;
+    return checksFailed ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Single-threaded epoll event loop with timer and signal helpers
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#include <csignal>
+#include <cerrno>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include "eventLoop.h"
+
+using namespace std;
+
+// Events handled per epoll_wait call
+#define MAX_EVENTS 32
+
+EventLoop::EventLoop() {
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) throw "Couldn't create epoll instance";
+    running = false;
+}
+
+EventLoop::~EventLoop() {
+    close(epfd);
+}
+
+void EventLoop::add(int fd, uint32_t events, function<void(uint32_t)> handler) {
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0) throw "Couldn't add fd to epoll";
+    handlers[fd] = move(handler);
+}
+
+void EventLoop::modify(int fd, uint32_t events) {
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.fd = fd;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void EventLoop::remove(int fd) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+    handlers.erase(fd);
+}
+
+int EventLoop::runOnce(int timeoutMs) {
+    epoll_event events[MAX_EVENTS];
+    int n = epoll_wait(epfd, events, MAX_EVENTS, timeoutMs);
+    if (n < 0) return (errno == EINTR) ? 0 : -1;
+    for (int i = 0; i < n; i++) {
+        // A handler may have removed this fd while handling an earlier event
+        auto it = handlers.find(events[i].data.fd);
+        if (it == handlers.end()) continue;
+        // Copy so the handler can safely remove itself
+        function<void(uint32_t)> handler = it->second;
+        handler(events[i].events);
+    }
+    return n;
+}
+
+void EventLoop::run() {
+    running = true;
+    while (running) {
+        if (runOnce(-1) < 0) break;
+    }
+}
+
+int makeTimer() {
+    return timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+}
+
+void armTimer(int fd, chrono::milliseconds delay, chrono::milliseconds interval) {
+    itimerspec spec = {};
+    spec.it_value.tv_sec = delay.count() / 1000;
+    spec.it_value.tv_nsec = (delay.count() % 1000) * 1000000;
+    spec.it_interval.tv_sec = interval.count() / 1000;
+    spec.it_interval.tv_nsec = (interval.count() % 1000) * 1000000;
+    timerfd_settime(fd, 0, &spec, nullptr);
+}
+
+uint64_t readTimer(int fd) {
+    uint64_t expirations = 0;
+    if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) return 0;
+    return expirations;
+}
+
+int makeSignalFd(initializer_list<int> signals) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (int sig : signals) sigaddset(&mask, sig);
+    if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) return -1;
+    return signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+}
+
+jthread startQuietThread(function<void()> fn) {
+    // The new thread inherits the mask it was created with
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    jthread worker(move(fn));
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    return worker;
+}
+
+bool parseSocketAddress(const string &text, int defaultPort, SocketAddress &address) {
+    address = SocketAddress();
+    if (text.rfind("unix:", 0) == 0 || text.find('/') != string::npos) {
+        string path = text.rfind("unix:", 0) == 0 ? text.substr(5) : text;
+        sockaddr_un *un = (sockaddr_un *)&address.storage;
+        if (path.empty() || path.size() >= sizeof(un->sun_path)) return false;
+        un->sun_family = AF_UNIX;
+        path.copy(un->sun_path, path.size());
+        address.length = sizeof(sockaddr_un);
+        address.path = path;
+        return true;
+    }
+
+    string host = text;
+    int port = defaultPort;
+    size_t colon = text.rfind(':');
+    if (colon != string::npos) {
+        host = text.substr(0, colon);
+        try {
+            size_t used = 0;
+            port = stoi(text.substr(colon + 1), &used);
+            if (used != text.size() - colon - 1) return false;
+        }
+        catch (...) {
+            return false;
+        }
+    }
+    if (port <= 0 || port > 65535) return false;
+    sockaddr_in *in = (sockaddr_in *)&address.storage;
+    in->sin_family = AF_INET;
+    in->sin_port = htons(port);
+    if (host.empty()) in->sin_addr.s_addr = htonl(INADDR_ANY);
+    else if (inet_pton(AF_INET, host.c_str(), &in->sin_addr) != 1) return false;
+    address.length = sizeof(sockaddr_in);
+    return true;
+}
+
+int makeStreamSocket(const SocketAddress &address) {
+    int fd = socket(address.storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || address.isUnix()) return fd;
+    // A result is often followed by the next shot straight away
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+bool unlinkSocketFile(const string &path) {
+    struct stat info;
+    if (lstat(path.c_str(), &info) != 0) return errno == ENOENT;
+    if (!S_ISSOCK(info.st_mode)) {
+        errno = EADDRINUSE;
+        return false;
+    }
+    return unlink(path.c_str()) == 0 || errno == ENOENT;
+}
+
+int listenOn(const SocketAddress &address, int backlog) {
+    if (address.isUnix() && !unlinkSocketFile(address.path)) return -1;
+    int fd = makeStreamSocket(address);
+    if (fd < 0) return -1;
+    if (!address.isUnix()) {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (bind(fd, address.get(), address.length) != 0 || listen(fd, backlog) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
@@ -0,0 +1,101 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Single-threaded epoll event loop with timer and signal helpers
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+using namespace std;
+
+// Calls a handler whenever one of its file descriptors is ready.
+// Sockets, eventfds, timerfds and signalfds all go through the same
+// epoll_wait, so the loop sleeps until something actually happens.
+class EventLoop {
+    private:
+        int epfd;
+        bool running;
+        unordered_map<int, function<void(uint32_t)>> handlers;
+
+    public:
+        EventLoop();
+        ~EventLoop();
+
+        // Watch fd for events (EPOLLIN, EPOLLOUT, ...). The handler gets the
+        // events that fired. Throws if epoll refuses the fd.
+        void add(int fd, uint32_t events, function<void(uint32_t)> handler);
+
+        // Change the events watched on fd
+        void modify(int fd, uint32_t events);
+
+        // Stop watching fd (does not close it)
+        void remove(int fd);
+
+        // Dispatch events until stop() is called
+        void run();
+
+        // Dispatch the events ready within timeout, returns how many fired
+        int runOnce(int timeoutMs);
+
+        void stop() { running = false; }
+};
+
+// Create a non-blocking timerfd. Returns -1 on failure.
+int makeTimer();
+
+// Fire the timer once after delay, then every interval (0 for one-shot).
+// A zero delay disarms the timer.
+void armTimer(int fd, chrono::milliseconds delay, chrono::milliseconds interval = chrono::milliseconds(0));
+
+// Read the expiry count so a level-triggered timer stops firing
+uint64_t readTimer(int fd);
+
+// Block the given signals for the whole process and return a signalfd that
+// receives them instead. Call before starting other threads so they inherit
+// the mask. Returns -1 on failure.
+int makeSignalFd(initializer_list<int> signals);
+
+// Start a helper thread with every signal blocked, so a signal always goes
+// to a thread that expects it (the signalfd, or its default action before
+// there is one), whenever the helper was started.
+jthread startQuietThread(function<void()> fn);
+
+// A TCP or UNIX-domain stream socket address
+struct SocketAddress {
+    sockaddr_storage storage = {};
+    socklen_t length = 0;
+    string path;        // The UNIX socket path, empty for TCP
+
+    bool isUnix() const { return !path.empty(); }
+    const sockaddr *get() const { return (const sockaddr *)&storage; }
+};
+
+// Parse "host", "host:port" or ":port" (every local address) as TCP, with
+// defaultPort when no port is given, and "unix:<path>" or anything with a
+// '/' in it as a UNIX socket. Returns false if text is neither.
+bool parseSocketAddress(const string &text, int defaultPort, SocketAddress &address);
+
+// Non-blocking stream socket for address, with Nagle off on TCP.
+// Returns -1 on failure.
+int makeStreamSocket(const SocketAddress &address);
+
+// Remove the UNIX socket file at path. Anything that isn't a socket is left
+// alone: returns false with errno set to EADDRINUSE. A path that doesn't
+// exist counts as removed.
+bool unlinkSocketFile(const string &path);
+
+// Non-blocking socket listening on address. A UNIX socket file left behind
+// by an earlier run is replaced, any other file at the path makes it fail
+// with EADDRINUSE. Returns -1 on failure.
+int listenOn(const SocketAddress &address, int backlog);
+
+#endif // EVENTLOOP_H
@@ -0,0 +1,193 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Seedable fleet generator with a reusable random engine and batch API
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef FLEETGENERATOR_H
+#define FLEETGENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "board.h"
+#include "placementTable.h"
+#include "sparseBoard.h"
+
+// Random positions tried for one ship of a sparse fleet before giving up
+#define SPARSE_PLACE_TRIES 100000
+
+using namespace std;
+
+// xoshiro256** engine. Much cheaper than mt19937 and fine for game layouts.
+// Satisfies UniformRandomBitGenerator so it also works with <random>.
+class FastRng {
+    private:
+        uint64_t s[4];
+
+        static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    public:
+        using result_type = uint64_t;
+
+        explicit FastRng(uint64_t seed = 0) { reseed(seed); }
+
+        // Expand a single seed into the full state with splitmix64.
+        void reseed(uint64_t seed) {
+            for (int i = 0; i < 4; i++) {
+                seed += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = seed;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                s[i] = z ^ (z >> 31);
+            }
+        }
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return UINT64_MAX; }
+
+        result_type operator()() {
+            uint64_t result = rotl(s[1] * 5, 7) * 9;
+            uint64_t t = s[1] << 17;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = rotl(s[3], 45);
+            return result;
+        }
+
+        // Unbiased value within [0, range] (Lemire's multiply and reject).
+        uint32_t bounded(uint32_t range) {
+            uint64_t n = uint64_t(range) + 1;
+            uint64_t m = uint64_t(uint32_t((*this)() >> 32)) * n;
+            if (uint32_t(m) < n) {
+                uint32_t threshold = uint32_t(-uint32_t(n)) % uint32_t(n);
+                while (uint32_t(m) < threshold) {
+                    m = uint64_t(uint32_t((*this)() >> 32)) * n;
+                }
+            }
+            return uint32_t(m >> 32);
+        }
+};
+
+// Generates fleet layouts from one engine owned by the generator.
+// Construct with a seed for reproducible layouts (replays and tests),
+// or without one to seed once from random_device.
+class FleetGenerator {
+    private:
+        FastRng rng;
+
+    public:
+        FleetGenerator() : rng((uint64_t(random_device{}()) << 32) | random_device{}()) {}
+        explicit FleetGenerator(uint64_t seed) : rng(seed) {}
+
+        // Restart the sequence, the same seed always gives the same layouts.
+        void seed(uint64_t seed) { rng.reseed(seed); }
+
+        FastRng &engine() { return rng; }
+
+        // Place the whole fleet (by default the configuration's own) on a
+        // cleared board. Ships never touch.
+        // Each ship is drawn uniformly from the precomputed placements that
+        // still fit, and the "still fits" sets of every ship length are
+        // narrowed with the placement's conflict masks. There is no retry
+        // loop per ship; if a dense fleet paints itself into a corner the
+        // layout is restarted.
+        template <typename Config>
+        void generate(BasicBoard<Config> &board, const unsigned short(& fleet)[Config::fleetCount] = Config::fleet) {
+            using Table = BasicPlacementTable<Config::gridSize>;
+            constexpr int fleetCount = Config::fleetCount;
+            const Table &table = Table::get();
+
+            // Distinct ship lengths in the fleet
+            unsigned short lengths[fleetCount];
+            int numLengths = 0;
+            for (int i = 0; i < fleetCount; i++) {
+                bool seen = false;
+                for (int j = 0; j < numLengths; j++) seen |= (lengths[j] == fleet[i]);
+                if (!seen) lengths[numLengths++] = fleet[i];
+            }
+
+            uint64_t avail[Config::gridSize + 1][Table::words];
+            while (true) {
+                board.reset();
+                for (int j = 0; j < numLengths; j++) table.fillAll(lengths[j], avail[lengths[j]]);
+
+                unsigned short ship_idx = 0;
+                for (; ship_idx < fleetCount; ship_idx++) {
+                    unsigned short ship_size = fleet[ship_idx];
+                    int n = Table::count(avail[ship_size]);
+                    if (n == 0) break;
+                    int pick = Table::nth(avail[ship_size], rng.bounded(n - 1));
+                    board.placeShip(ship_idx, table.placements(ship_size)[pick].ship);
+                    for (int j = 0; j < numLengths; j++) {
+                        table.removeConflicts(ship_size, pick, lengths[j], avail[lengths[j]]);
+                    }
+                }
+                if (ship_idx == fleetCount) return;
+            }
+        }
+
+        // Same placement rules drawn by rejection sampling, as autogenFleet does.
+        // Kept for comparison in the benchmark.
+        template <typename Config>
+        void generateRejection(BasicBoard<Config> &board,
+                               const unsigned short(& fleet)[Config::fleetCount] = Config::fleet) {
+            constexpr int size = Config::gridSize;
+            board.reset();
+            typename BasicBoard<Config>::Plane blocked;
+            for (unsigned short ship_idx = 0; ship_idx < Config::fleetCount; ship_idx++) {
+                unsigned short ship_size = fleet[ship_idx];
+                while (true) {
+                    bool isHorizontal = rng.bounded(1);
+                    int max_row = isHorizontal ? size - 1 : size - ship_size;
+                    int max_col = isHorizontal ? size - ship_size : size - 1;
+                    int start_row = rng.bounded(max_row);
+                    int start_col = rng.bounded(max_col);
+
+                    auto mask = shipMask<size>(start_row, start_col, ship_size, isHorizontal);
+                    if (mask.intersects(blocked)) {
+                        continue;
+                    }
+                    board.placeShip(ship_idx, mask);
+                    blocked |= haloMask<size>(start_row, start_col, ship_size, isHorizontal);
+                    break;
+                }
+            }
+        }
+
+        // Place fleet on a cleared sparse board by rejection sampling: on a
+        // large board almost every random position is free, so no placement
+        // table is needed. Throws if a ship finds no room after
+        // SPARSE_PLACE_TRIES positions.
+        void generate(SparseBoard &board, const vector<unsigned short> &fleet) {
+            board.reset(board.size);
+            for (unsigned short ship_size : fleet) {
+                int tries = 0;
+                while (true) {
+                    if (tries++ == SPARSE_PLACE_TRIES) throw "The fleet doesn't fit on the grid";
+                    bool isHorizontal = rng.bounded(1);
+                    int max_row = isHorizontal ? board.size - 1 : board.size - ship_size;
+                    int max_col = isHorizontal ? board.size - ship_size : board.size - 1;
+                    if (max_row < 0 || max_col < 0) continue;
+                    int start_row = rng.bounded(max_row);
+                    int start_col = rng.bounded(max_col);
+                    if (!board.fits(start_row, start_col, ship_size, isHorizontal)) continue;
+                    board.placeShip(start_row, start_col, ship_size, isHorizontal);
+                    break;
+                }
+            }
+        }
+
+        // Fill count boards in out with independent layouts.
+        template <typename Config>
+        void generateBatch(BasicBoard<Config> *out, size_t count,
+                           const unsigned short(& fleet)[Config::fleetCount] = Config::fleet) {
+            for (size_t i = 0; i < count; i++) {
+                generate(out[i], fleet);
+            }
+        }
+};
+
+#endif // FLEETGENERATOR_H
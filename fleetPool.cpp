@@ -0,0 +1,54 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Pool of fleet layouts generated ahead of time on a background thread
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#include "eventLoop.h"
+#include "fleetPool.h"
+
+using namespace std;
+
+FleetPool::FleetPool(uint64_t seed, const unsigned short (&fleetLengths)[FLEET_COUNT]) : generator(seed) {
+    for (int i = 0; i < FLEET_COUNT; i++) fleet[i] = fleetLengths[i];
+    // The pool thread never takes the game's Ctrl+C
+    worker = startQuietThread([this] { refill(); });
+}
+
+FleetPool::~FleetPool() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    worker.join();
+}
+
+void FleetPool::refill() {
+    Board next;
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        changed.wait(guard, [this] { return stopping || count < FLEET_POOL_SIZE; });
+        if (stopping) return;
+
+        // Generate without holding the lock, take() isn't kept waiting
+        guard.unlock();
+        generator.generate(next, fleet);
+        guard.lock();
+        layouts[(head + count) % FLEET_POOL_SIZE] = next;
+        count++;
+        changed.notify_all();
+    }
+}
+
+void FleetPool::take(Board &board) {
+    unique_lock<mutex> guard(lock);
+    changed.wait(guard, [this] { return count > 0; });
+    board = layouts[head];
+    head = (head + 1) % FLEET_POOL_SIZE;
+    count--;
+    changed.notify_all();
+}
+
+size_t FleetPool::ready() {
+    lock_guard<mutex> guard(lock);
+    return count;
+}
@@ -0,0 +1,53 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Pool of fleet layouts generated ahead of time on a background thread
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef FLEETPOOL_H
+#define FLEETPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "board.h"
+#include "fleetGenerator.h"
+
+// Layouts kept ready
+#define FLEET_POOL_SIZE 8
+
+using namespace std;
+
+// Fleet layouts generated ahead of time, so a new game (the first one or a
+// rematch) takes its fleet without generating one. A background thread
+// fills the pool and refills it after every take(). The layouts come from
+// one seeded generator, so the same seed gives the same sequence of fleets.
+class FleetPool {
+    private:
+        FleetGenerator generator;     // Only used by the pool thread
+        unsigned short fleet[FLEET_COUNT];
+        Board layouts[FLEET_POOL_SIZE];
+        size_t head = 0;              // Oldest layout
+        size_t count = 0;             // Layouts ready
+        bool stopping = false;
+        mutex lock;
+        condition_variable changed;
+        jthread worker;               // Last, so it stops before the rest goes
+
+        void refill();
+
+    public:
+        FleetPool(uint64_t seed, const unsigned short (&fleetLengths)[FLEET_COUNT]);
+        ~FleetPool();
+
+        FleetPool(const FleetPool &) = delete;
+        FleetPool &operator=(const FleetPool &) = delete;
+
+        // Copy the oldest layout into board, waiting if the pool is empty
+        void take(Board &board);
+
+        // Layouts ready right now
+        size_t ready();
+};
+
+#endif // FLEETPOOL_H
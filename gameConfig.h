@@ -0,0 +1,96 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Compile-time grid and fleet configurations of the game
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef GAMECONFIG_H
+#define GAMECONFIG_H
+
+#include <string_view>
+#include "protocol.h"   // BIN_MAX_GRID
+
+// Longest fleet a configuration may have
+#define MAX_FLEET_COUNT 16
+
+using namespace std;
+
+// True if the fleet can be laid out on a size x size grid without ships
+// touching. Ships go longest first along every other row, one cell apart,
+// each into the first row it fits. A fleet this rejects might still fit
+// some other way, but one it accepts always does, so the generators can't
+// get stuck.
+consteval bool fleetFits(int size, const unsigned short *fleet, int count) {
+    if (count <= 0 || count > MAX_FLEET_COUNT) return false;
+    unsigned short sorted[MAX_FLEET_COUNT] = {};
+    for (int i = 0; i < count; i++) {
+        if (fleet[i] == 0 || fleet[i] > size) return false;
+        int j = i;
+        for (; j > 0 && sorted[j - 1] < fleet[i]; j--) sorted[j] = sorted[j - 1];
+        sorted[j] = fleet[i];
+    }
+
+    // A row of size cells holds ships whose lengths plus one gap each add up to size + 1
+    int used[MAX_FLEET_COUNT] = {};
+    int rows = (size + 1) / 2;
+    for (int i = 0; i < count; i++) {
+        int r = 0;
+        while (r < rows && r < MAX_FLEET_COUNT && used[r] + sorted[i] + 1 > size + 1) r++;
+        if (r == rows || r == MAX_FLEET_COUNT) return false;
+        used[r] += sorted[i] + 1;
+    }
+    return true;
+}
+
+// One variant of the game: a Size x Size grid and the ship lengths of the
+// fleet, largest first by convention. Boards, placement tables, the
+// targeting engine and the renderer are instantiated per configuration, so
+// each gets arrays sized exactly to its grid and loops the compiler can
+// unroll.
+template <int Size, unsigned short... Ships>
+struct GameConfig {
+    static constexpr int gridSize = Size;
+    static constexpr int cells = Size * Size;
+    static constexpr int fleetCount = sizeof...(Ships);
+    static constexpr unsigned short fleet[fleetCount] = {Ships...};
+    static constexpr int fleetCells = (Ships + ...);
+
+    static_assert(Size >= 2 && Size <= BIN_MAX_GRID, "coordinates are sent as one byte");
+    static_assert(fleetFits(Size, fleet, fleetCount), "the fleet doesn't fit on the grid without ships touching");
+};
+
+// 64 cells, one word per bit plane
+struct SmallGame : GameConfig<8, 4, 3, 3, 2, 2> {
+    static constexpr const char *name = "small";
+};
+
+// The game as played on the keypad: 100 cells, two words per bit plane
+struct ClassicGame : GameConfig<10, 5, 4, 3, 3, 2, 2, 2> {
+    static constexpr const char *name = "classic";
+};
+
+// 144 cells, three words per bit plane
+struct LargeGame : GameConfig<12, 5, 4, 4, 3, 3, 3, 2, 2> {
+    static constexpr const char *name = "large";
+};
+
+// Every precompiled configuration, for explicit instantiations and for
+// choosing one at run time. Add a new variant here.
+#define FOR_EACH_GAME_CONFIG(X) X(SmallGame) X(ClassicGame) X(LargeGame)
+
+#define GAME_CONFIG_NAMES "small, classic or large"
+
+// Call fn with the configuration called name (fn(SmallGame()) and so on),
+// so one generic function serves every variant. Returns false if no
+// configuration has that name.
+template <typename Fn>
+bool withGameConfig(string_view name, Fn &&fn) {
+#define GAME_CONFIG_CASE(Config) \
+    if (name == Config::name) {  \
+        fn(Config());            \
+        return true;             \
+    }
+    FOR_EACH_GAME_CONFIG(GAME_CONFIG_CASE)
+#undef GAME_CONFIG_CASE
+    return false;
+}
+
+#endif // GAMECONFIG_H
@@ -0,0 +1,164 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Shot resolution and message text shared by the game client and the load driver
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef GAMERULES_H
+#define GAMERULES_H
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include "board.h"
+#include "protocol.h"
+#include "sparseBoard.h"
+
+using namespace std;
+
+// Longest message built by the helpers below, with its "\r\n"
+#define MESSAGE_TEXT_SIZE 64
+
+// Check if all ships in the grid are sunk.
+// A cell is considered part of a ship if it is not " " and not marked as hit ("X") or miss ("o").
+inline bool allShipsSunk(const string (&grid)[GRID_SIZE][GRID_SIZE]) {
+    for (int i = 0; i < GRID_SIZE; i++) {
+        for (int j = 0; j < GRID_SIZE; j++) {
+            if (grid[i][j] != " " && grid[i][j] != "X" && grid[i][j] != "o")
+                return false;
+        }
+    }
+    return true;
+}
+
+// Same rules on a string map: a ship cell becomes "X", open water "o".
+inline ShotResult resolveShot(string (&grid)[GRID_SIZE][GRID_SIZE], int x, int y) {
+    string &cell = grid[y][x];
+    if (cell != " " && cell != "X" && cell != "o") {
+        cell = "X";
+        return allShipsSunk(grid) ? RESULT_WIN : RESULT_HIT;
+    }
+    if (cell == " ") cell = "o";
+    return RESULT_MISS;
+}
+
+// Apply the opponent's shot at (x, y) to our own board and return the
+// reply to send. Shooting a ship cell that was already hit counts as a miss.
+// When the shot sinks a ship (but not the last one) the result is
+// RESULT_SUNK and sunkSize, if given, is set to the ship's size. Only
+// counters are updated, nothing is rescanned.
+template <typename Config>
+inline ShotResult resolveShot(BasicBoard<Config> &myMap, int x, int y, int *sunkSize = nullptr) {
+    if (myMap.isShip(y, x)) {
+        int s = myMap.markHit(y, x);
+        if (s < 0) return RESULT_MISS;
+        if (myMap.allShipsSunk()) return RESULT_WIN;
+        if (myMap.isSunk(s)) {
+            if (sunkSize) *sunkSize = myMap.shipSize[s];
+            return RESULT_SUNK;
+        }
+        return RESULT_HIT;
+    }
+    myMap.markMiss(y, x);
+    return RESULT_MISS;
+}
+
+// Record the reply to our shot at (x, y) on the view of the opponent's board.
+template <typename Config>
+inline void recordResult(BasicBoard<Config> &oppMap, int x, int y, ShotResult result) {
+    if (isHit(result)) oppMap.markHit(y, x);
+    else oppMap.markMiss(y, x);
+}
+
+// The same rules on a sparse board (large event mode)
+inline ShotResult resolveShot(SparseBoard &myMap, int x, int y, int *sunkSize = nullptr) {
+    if (myMap.isShip(y, x)) {
+        int s = myMap.markHit(y, x);
+        if (s < 0) return RESULT_MISS;
+        if (myMap.allShipsSunk()) return RESULT_WIN;
+        if (myMap.isSunk(s)) {
+            if (sunkSize) *sunkSize = myMap.ships[s].size;
+            return RESULT_SUNK;
+        }
+        return RESULT_HIT;
+    }
+    myMap.markMiss(y, x);
+    return RESULT_MISS;
+}
+
+inline void recordResult(SparseBoard &oppMap, int x, int y, ShotResult result) {
+    if (isHit(result)) oppMap.markHit(y, x);
+    else oppMap.markMiss(y, x);
+}
+
+// Message text written into buf (MESSAGE_TEXT_SIZE bytes). Return the length.
+inline int formatReady(char *buf, const char *name, const char *gameId, const char *caps = "") {
+    if (!*caps) return snprintf(buf, MESSAGE_TEXT_SIZE, "READY,%s,%s\r\n", name, gameId);
+    return snprintf(buf, MESSAGE_TEXT_SIZE, "READY,%s,%s,%s\r\n", name, gameId, caps);
+}
+
+inline int formatPlay(char *buf, int x, int y) {
+    return snprintf(buf, MESSAGE_TEXT_SIZE, "PLAY,%d,%d\r\n", x, y);
+}
+
+// RESULT_SUNK is sent as SUNK with the size if the opponent announced
+// CAP_SUNK, and as a plain HIT otherwise.
+inline int formatResult(char *buf, ShotResult result, int sunkSize = 0, bool peerSunk = false) {
+    if (result == RESULT_SUNK && peerSunk) {
+        return snprintf(buf, MESSAGE_TEXT_SIZE, "PLAY,RESULT,SUNK,%d\r\n", sunkSize);
+    }
+    const char *text = result == RESULT_WIN ? "WIN" : (isHit(result) ? "HIT" : "MISS");
+    return snprintf(buf, MESSAGE_TEXT_SIZE, "PLAY,RESULT,%s\r\n", text);
+}
+
+// Counts are sent mod 256, only the difference between the two sides matters
+inline int formatResume(char *buf, int answered, int received) {
+    return snprintf(buf, MESSAGE_TEXT_SIZE, "RESUME,%d,%d\r\n", answered & 0xFF, received & 0xFF);
+}
+
+// The same messages as binary records (BIN_RECORD_SIZE bytes)
+inline int encodePlay(char *buf, int x, int y) {
+    buf[0] = (char)BIN_TAG_PLAY;
+    buf[1] = (char)x;
+    buf[2] = (char)y;
+    return BIN_RECORD_SIZE;
+}
+
+inline int encodeResult(char *buf, ShotResult result, int sunkSize = 0, bool peerSunk = false) {
+    if (result == RESULT_SUNK && !peerSunk) result = RESULT_HIT;
+    buf[0] = (char)BIN_TAG_RESULT;
+    buf[1] = (char)result;
+    buf[2] = (char)(result == RESULT_SUNK ? sunkSize : 0);
+    return BIN_RECORD_SIZE;
+}
+
+inline int encodeResume(char *buf, int answered, int received) {
+    buf[0] = (char)BIN_TAG_RESUME;
+    buf[1] = (char)(answered & 0xFF);
+    buf[2] = (char)(received & 0xFF);
+    return BIN_RECORD_SIZE;
+}
+
+// How messages to the opponent are written, as agreed in READY and START
+struct WireFormat {
+    bool binary = false;      // Both players announced CAP_BIN
+    bool peerSunk = false;    // The opponent announced CAP_SUNK
+
+    // ours: the capabilities we sent in READY, theirs: those in START
+    void negotiate(string_view ours, string_view theirs) {
+        binary = useBinaryRecords(ours, theirs);
+        peerSunk = hasCapability(theirs, CAP_SUNK);
+    }
+
+    int play(char *buf, int x, int y) const {
+        return binary ? encodePlay(buf, x, y) : formatPlay(buf, x, y);
+    }
+
+    int result(char *buf, ShotResult result, int sunkSize) const {
+        return binary ? encodeResult(buf, result, sunkSize, peerSunk) : formatResult(buf, result, sunkSize, peerSunk);
+    }
+
+    int resume(char *buf, int answered, int received) const {
+        return binary ? encodeResume(buf, answered, received) : formatResume(buf, answered, received);
+    }
+};
+
+#endif // GAMERULES_H
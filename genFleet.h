@@ -7,16 +7,20 @@
 #include <cstdlib>
 #include <algorithm>
 #include <random>
+#include "gameConfig.h"
 
 #define FLEET_COUNT   7
 #define GRID_SIZE    10
 
+static_assert(ClassicGame::gridSize == GRID_SIZE && ClassicGame::fleetCount == FLEET_COUNT,
+              "GRID_SIZE and FLEET_COUNT describe the classic game");
+
 using namespace std;
 
 // Returns a random unsigned short within the range [0, range]
+// The engine is seeded once per thread instead of on every call.
 inline unsigned short bounded_rand(unsigned short range) {
-    random_device dev;
-    mt19937 rng(dev());
+    thread_local mt19937 rng(random_device{}());
     uniform_int_distribution<mt19937::result_type> dist6(0, range);
     return static_cast<unsigned short>(dist6(rng));
 }
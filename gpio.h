@@ -0,0 +1,84 @@
+/* ECEGRE-2020 - Seattle University
+   Description: GPIO backend interface used by the keypad class
+   Authors: Brayton Alvarez and Paolo Saliba
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#pragma once  // include only once
+
+// Pin modes and pull settings (same values as wiringPi)
+#define GPIO_INPUT    0
+#define GPIO_OUTPUT   1
+#define GPIO_PUD_OFF  0
+#define GPIO_PUD_DOWN 1
+#define GPIO_PUD_UP   2
+
+// Interface to the GPIO pins. The keypad only talks to the pins through this,
+// so it can run on wiringPi on a Pi or on the in-process mock anywhere else.
+class GpioBackend
+{
+    public:
+        virtual ~GpioBackend() {}
+
+        // Set a pin to GPIO_INPUT or GPIO_OUTPUT
+        virtual void pin_mode(int pin, int mode) = 0;
+
+        // Set the pull resistor of an input pin
+        virtual void pull_up_dn(int pin, int pud) = 0;
+
+        // Drive an output pin low (0) or high (1)
+        virtual void digital_write(int pin, int value) = 0;
+
+        // Read the level of a pin
+        virtual int digital_read(int pin) = 0;
+
+        // Arm falling edge detection on the given pins.
+        // Returns false if the backend cannot detect edges.
+        virtual bool arm_edges(const int *pins, int count) = 0;
+
+        // Block until an armed pin sees a falling edge or the timeout runs out.
+        // Returns true if an edge arrived.
+        virtual bool wait_edge(std::chrono::milliseconds timeout) = 0;
+
+        // Bulk operations on pins 0-31, given as bit masks (bit n = pin n).
+        // The defaults go pin by pin; backends with direct register access
+        // override them to touch each register once.
+
+        // Set every pin in mask to mode
+        virtual void set_modes(uint32_t mask, int mode) {
+            for (int pin = 0; pin < 32; pin++) {
+                if (mask & (uint32_t(1) << pin)) pin_mode(pin, mode);
+            }
+        }
+
+        // Set the pull resistor of every pin in mask
+        virtual void set_pulls(uint32_t mask, int pud) {
+            for (int pin = 0; pin < 32; pin++) {
+                if (mask & (uint32_t(1) << pin)) pull_up_dn(pin, pud);
+            }
+        }
+
+        // Drive every output pin in mask to the matching bit of levels
+        virtual void write_mask(uint32_t mask, uint32_t levels) {
+            for (int pin = 0; pin < 32; pin++) {
+                if (mask & (uint32_t(1) << pin)) digital_write(pin, (levels >> pin) & 1);
+            }
+        }
+
+        // Read the levels of the pins in mask, other bits are zero
+        virtual uint32_t read_mask(uint32_t mask) {
+            uint32_t levels = 0;
+            for (int pin = 0; pin < 32; pin++) {
+                if ((mask & (uint32_t(1) << pin)) && digital_read(pin)) levels |= uint32_t(1) << pin;
+            }
+            return levels;
+        }
+};
+
+// The backend the game and Hw4 use. Each backend file (gpioWiringPi.cpp,
+// gpioMmap.cpp, gpioMock.cpp) defines this, so the file linked in picks the
+// backend. The mock's is weak and gives way to any other linked with it.
+std::unique_ptr<GpioBackend> make_gpio_backend();
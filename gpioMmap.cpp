@@ -0,0 +1,134 @@
+/* ECEGRE-2020 - Seattle University
+   Description: GPIO backend that maps the GPIO register block directly
+   Authors: Brayton Alvarez and Paolo Saliba
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <thread>
+#include "gpioMmap.h"
+
+using namespace std;
+
+// Register offsets in 32-bit words
+#define GPFSEL0    0    // Function select, 3 bits per pin, 10 pins per register
+#define GPSET0     7    // Write 1 to drive high
+#define GPCLR0     10   // Write 1 to drive low
+#define GPLEV0     13   // Pin levels
+#define GPPUD      37   // Pull type for the clocked sequence (BCM2835-7)
+#define GPPUDCLK0  38   // Pins the pull type is clocked into (BCM2835-7)
+#define GPPUPPDN0  57   // Pull type, 2 bits per pin (BCM2711)
+
+MmapGpio::MmapGpio(const string &path, bool isBcm2711){
+    bcm2711 = isBcm2711;
+
+    int fd = open(path.c_str(), O_RDWR | O_SYNC);
+    if (fd < 0) throw "Couldn't open GPIO register block";
+
+    // An ordinary file stands in for the registers, make it big enough
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size < GPIO_BLOCK_SIZE) {
+        if (ftruncate(fd, GPIO_BLOCK_SIZE) != 0) {
+            close(fd);
+            throw "Couldn't size GPIO register file";
+        }
+    }
+
+    void *map = mmap(nullptr, GPIO_BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) throw "Couldn't map GPIO register block";
+    regs = static_cast<volatile uint32_t *>(map);
+}
+
+MmapGpio::~MmapGpio(){
+    munmap(const_cast<uint32_t *>(regs), GPIO_BLOCK_SIZE);
+}
+
+// The legacy pull sequence needs 150 cycles between steps
+void MmapGpio::pull_delay() {
+    this_thread::sleep_for(chrono::microseconds(1));
+}
+
+void MmapGpio::set_modes(uint32_t mask, int mode) {
+    uint32_t fsel = (mode == GPIO_OUTPUT) ? 1 : 0;
+    for (int reg = 0; reg < 4; reg++) {
+        uint32_t pins = (mask >> (reg * 10)) & 0x3FF;
+        if (!pins) continue;
+        uint32_t value = regs[GPFSEL0 + reg];
+        for (int i = 0; i < 10; i++) {
+            if (pins & (1u << i)) value = (value & ~(7u << (i * 3))) | (fsel << (i * 3));
+        }
+        regs[GPFSEL0 + reg] = value;
+    }
+}
+
+void MmapGpio::set_pulls(uint32_t mask, int pud) {
+    if (bcm2711) {
+        // 00 none, 01 up, 10 down
+        uint32_t bits = (pud == GPIO_PUD_UP) ? 1 : (pud == GPIO_PUD_DOWN) ? 2 : 0;
+        for (int reg = 0; reg < 2; reg++) {
+            uint32_t pins = (mask >> (reg * 16)) & 0xFFFF;
+            if (!pins) continue;
+            uint32_t value = regs[GPPUPPDN0 + reg];
+            for (int i = 0; i < 16; i++) {
+                if (pins & (1u << i)) value = (value & ~(3u << (i * 2))) | (bits << (i * 2));
+            }
+            regs[GPPUPPDN0 + reg] = value;
+        }
+        return;
+    }
+
+    // Clock the pull type into every pin of the mask at once
+    regs[GPPUD] = (pud == GPIO_PUD_UP) ? 2 : (pud == GPIO_PUD_DOWN) ? 1 : 0;
+    pull_delay();
+    regs[GPPUDCLK0] = mask;
+    pull_delay();
+    regs[GPPUD] = 0;
+    regs[GPPUDCLK0] = 0;
+}
+
+void MmapGpio::write_mask(uint32_t mask, uint32_t levels) {
+    if (mask & levels) regs[GPSET0] = mask & levels;
+    if (mask & ~levels) regs[GPCLR0] = mask & ~levels;
+}
+
+uint32_t MmapGpio::read_mask(uint32_t mask) {
+    return regs[GPLEV0] & mask;
+}
+
+void MmapGpio::pin_mode(int pin, int mode) {
+    set_modes(uint32_t(1) << pin, mode);
+}
+
+void MmapGpio::pull_up_dn(int pin, int pud) {
+    set_pulls(uint32_t(1) << pin, pud);
+}
+
+void MmapGpio::digital_write(int pin, int value) {
+    write_mask(uint32_t(1) << pin, value ? uint32_t(1) << pin : 0);
+}
+
+int MmapGpio::digital_read(int pin) {
+    return read_mask(uint32_t(1) << pin) ? 1 : 0;
+}
+
+// No interrupts through the register map, the keypad falls back to polling
+bool MmapGpio::arm_edges(const int * /*pins*/, int /*count*/) {
+    return false;
+}
+
+bool MmapGpio::wait_edge(chrono::milliseconds timeout) {
+    this_thread::sleep_for(timeout);
+    return false;
+}
+
+// The Pi's register block. Set GPIO_BCM2711=1 on a Pi 4, whose pull
+// registers differ from the older chips'.
+unique_ptr<GpioBackend> make_gpio_backend() {
+    const char *bcm2711 = getenv("GPIO_BCM2711");
+    return make_unique<MmapGpio>("/dev/gpiomem", bcm2711 && strcmp(bcm2711, "0") != 0);
+}
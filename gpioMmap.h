@@ -0,0 +1,49 @@
+/* ECEGRE-2020 - Seattle University
+   Description: GPIO backend that maps the GPIO register block directly
+   Authors: Brayton Alvarez and Paolo Saliba
+*/
+
+#include <cstdint>
+#include <string>
+#include "gpio.h"
+
+#pragma once  // include only once
+
+// Size of the mapped register block
+#define GPIO_BLOCK_SIZE 4096
+
+// Drives the pins by reading and writing the BCM283x/BCM2711 GPIO registers
+// through a memory map, so a bulk operation is a handful of register
+// accesses instead of one library call per pin.
+// The path is normally /dev/gpiomem. Any ordinary file works too: it is
+// grown to GPIO_BLOCK_SIZE and used as a fake register block, which lets the
+// scan logic be tested and benchmarked off the Pi (writes to the set/clear
+// registers then don't show up in the level register on their own).
+class MmapGpio : public GpioBackend
+{
+    private:
+        volatile uint32_t *regs;
+        bool bcm2711;     // Pi 4 style pull registers
+
+        void pull_delay();
+
+    public:
+        // Throws if the block can't be opened or mapped
+        MmapGpio(const std::string &path = "/dev/gpiomem", bool isBcm2711 = false);
+        ~MmapGpio();
+
+        // Direct access to the register block (32-bit words)
+        volatile uint32_t *registers() { return regs; }
+
+        void pin_mode(int pin, int mode) override;
+        void pull_up_dn(int pin, int pud) override;
+        void digital_write(int pin, int value) override;
+        int digital_read(int pin) override;
+        bool arm_edges(const int *pins, int count) override;
+        bool wait_edge(std::chrono::milliseconds timeout) override;
+
+        void set_modes(uint32_t mask, int mode) override;
+        void set_pulls(uint32_t mask, int pud) override;
+        void write_mask(uint32_t mask, uint32_t levels) override;
+        uint32_t read_mask(uint32_t mask) override;
+};
@@ -0,0 +1,111 @@
+/* ECEGRE-2020 - Seattle University
+   Description: In-process mock of the GPIO pins wired to a key matrix
+   Authors: Brayton Alvarez and Paolo Saliba
+*/
+
+#include <algorithm>
+#include "gpioMock.h"
+
+using namespace std;
+
+MockGpio::MockGpio(){
+    for (int i = 0; i < MOCK_PINS; i++) {
+        mode[i] = GPIO_INPUT;
+        pud[i] = GPIO_PUD_OFF;
+        level[i] = 0;
+        armed[i] = false;
+        armed_level[i] = 1;
+    }
+    pending_edges = 0;
+}
+
+// Level of a pin, caller holds pin_mutex
+int MockGpio::read_locked(int pin) {
+    if (mode[pin] == GPIO_OUTPUT) return level[pin];
+
+    // An input follows any output it is switched to
+    for (auto &sw : closed) {
+        int other = -1;
+        if (sw.first == pin) other = sw.second;
+        else if (sw.second == pin) other = sw.first;
+        if (other >= 0 && mode[other] == GPIO_OUTPUT) return level[other];
+    }
+    return pud[pin] == GPIO_PUD_DOWN ? 0 : 1;
+}
+
+// Record a falling edge on any armed pin, caller holds pin_mutex
+void MockGpio::check_edges_locked() {
+    bool edge = false;
+    for (int i = 0; i < MOCK_PINS; i++) {
+        if (!armed[i]) continue;
+        int now = read_locked(i);
+        if (armed_level[i] == 1 && now == 0) edge = true;
+        armed_level[i] = now;
+    }
+    if (edge) {
+        pending_edges++;
+        edge_cv.notify_all();
+    }
+}
+
+void MockGpio::press(int pin_a, int pin_b) {
+    lock_guard<mutex> lock(pin_mutex);
+    closed.push_back({pin_a, pin_b});
+    check_edges_locked();
+}
+
+void MockGpio::release(int pin_a, int pin_b) {
+    lock_guard<mutex> lock(pin_mutex);
+    auto it = find(closed.begin(), closed.end(), make_pair(pin_a, pin_b));
+    if (it != closed.end()) closed.erase(it);
+    check_edges_locked();
+}
+
+void MockGpio::pin_mode(int pin, int m) {
+    lock_guard<mutex> lock(pin_mutex);
+    mode[pin] = m;
+    check_edges_locked();
+}
+
+void MockGpio::pull_up_dn(int pin, int p) {
+    lock_guard<mutex> lock(pin_mutex);
+    pud[pin] = p;
+    check_edges_locked();
+}
+
+void MockGpio::digital_write(int pin, int value) {
+    lock_guard<mutex> lock(pin_mutex);
+    level[pin] = value ? 1 : 0;
+    check_edges_locked();
+}
+
+int MockGpio::digital_read(int pin) {
+    lock_guard<mutex> lock(pin_mutex);
+    return read_locked(pin);
+}
+
+bool MockGpio::arm_edges(const int *pins, int count) {
+    lock_guard<mutex> lock(pin_mutex);
+    for (int i = 0; i < count; i++) {
+        if (pins[i] < 0 || pins[i] >= MOCK_PINS) return false;
+        armed[pins[i]] = true;
+        armed_level[pins[i]] = read_locked(pins[i]);
+    }
+    pending_edges = 0;
+    return true;
+}
+
+bool MockGpio::wait_edge(chrono::milliseconds timeout) {
+    unique_lock<mutex> lock(pin_mutex);
+    if (!edge_cv.wait_for(lock, timeout, [this] { return pending_edges > 0; })) return false;
+    pending_edges = 0;
+    return true;
+}
+
+// Off the Pi nothing presses the simulated keys, so the game runs with a
+// keypad that stays idle (autoplay with -a still plays). Weak, so a program
+// linking the mock next to another backend (bench, testKeypad) uses the
+// other one's.
+__attribute__((weak)) unique_ptr<GpioBackend> make_gpio_backend() {
+    return make_unique<MockGpio>();
+}
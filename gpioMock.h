@@ -0,0 +1,50 @@
+/* ECEGRE-2020 - Seattle University
+   Description: In-process mock of the GPIO pins wired to a key matrix
+   Authors: Brayton Alvarez and Paolo Saliba
+*/
+
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "gpio.h"
+
+#pragma once  // include only once
+
+// Number of simulated pins
+#define MOCK_PINS 32
+
+// Simulates the pins and the switches of a key matrix, so the keypad can be
+// built and driven on a machine with no Pi attached. A pressed key connects
+// its row pin to its column pin: an input pin reads the level of an output pin
+// it is connected to, otherwise its pull resistor.
+class MockGpio : public GpioBackend
+{
+    private:
+        std::mutex pin_mutex;
+        std::condition_variable edge_cv;
+        int mode[MOCK_PINS];
+        int pud[MOCK_PINS];
+        int level[MOCK_PINS];        // Driven level of output pins
+        bool armed[MOCK_PINS];
+        int armed_level[MOCK_PINS];  // Last seen level of armed pins
+        int pending_edges;
+        std::vector<std::pair<int, int>> closed;  // Pressed switches
+
+        int read_locked(int pin);
+        void check_edges_locked();
+
+    public:
+        MockGpio();
+
+        // Close or open the switch between two pins
+        void press(int pin_a, int pin_b);
+        void release(int pin_a, int pin_b);
+
+        void pin_mode(int pin, int mode) override;
+        void pull_up_dn(int pin, int pud) override;
+        void digital_write(int pin, int value) override;
+        int digital_read(int pin) override;
+        bool arm_edges(const int *pins, int count) override;
+        bool wait_edge(std::chrono::milliseconds timeout) override;
+};
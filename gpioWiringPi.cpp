@@ -0,0 +1,76 @@
+/* ECEGRE-2020 - Seattle University
+   Description: wiringPi implementation of the GPIO backend
+   Authors: Brayton Alvarez and Paolo Saliba
+*/
+
+#include <wiringPi.h>
+#include "gpioWiringPi.h"
+
+using namespace std;
+
+WiringPiGpio *WiringPiGpio::instance = nullptr;
+
+WiringPiGpio::WiringPiGpio(){
+    // Setup wiringPi
+    wiringPiSetupGpio();
+
+    pending_edges = 0;
+    for (int i = 0; i < WIRINGPI_PINS; i++) isr_registered[i] = false;
+    instance = this;
+}
+
+void WiringPiGpio::pin_mode(int pin, int mode) {
+    pinMode(pin, mode == GPIO_OUTPUT ? OUTPUT : INPUT);
+}
+
+void WiringPiGpio::pull_up_dn(int pin, int pud) {
+    if (pud == GPIO_PUD_UP) pullUpDnControl(pin, PUD_UP);
+    else if (pud == GPIO_PUD_DOWN) pullUpDnControl(pin, PUD_DOWN);
+    else pullUpDnControl(pin, PUD_OFF);
+}
+
+void WiringPiGpio::digital_write(int pin, int value) {
+    digitalWrite(pin, value);
+}
+
+int WiringPiGpio::digital_read(int pin) {
+    return digitalRead(pin);
+}
+
+// Called from the wiringPi interrupt thread on every falling edge
+void WiringPiGpio::on_interrupt() {
+    if (!instance) return;
+    {
+        lock_guard<mutex> lock(instance->edge_mutex);
+        instance->pending_edges++;
+    }
+    instance->edge_cv.notify_one();
+}
+
+bool WiringPiGpio::arm_edges(const int *pins, int count) {
+    // wiringPi keeps an interrupt registered once it is set up, so each pin
+    // only needs registering the first time it is armed.
+    for (int i = 0; i < count; i++) {
+        int pin = pins[i];
+        if (pin < 0 || pin >= WIRINGPI_PINS) return false;
+        if (!isr_registered[pin]) {
+            if (wiringPiISR(pin, INT_EDGE_FALLING, &WiringPiGpio::on_interrupt) < 0) return false;
+            isr_registered[pin] = true;
+        }
+    }
+    // Forget edges caused while the pins were being reconfigured
+    lock_guard<mutex> lock(edge_mutex);
+    pending_edges = 0;
+    return true;
+}
+
+bool WiringPiGpio::wait_edge(chrono::milliseconds timeout) {
+    unique_lock<mutex> lock(edge_mutex);
+    if (!edge_cv.wait_for(lock, timeout, [this] { return pending_edges > 0; })) return false;
+    pending_edges = 0;
+    return true;
+}
+
+unique_ptr<GpioBackend> make_gpio_backend() {
+    return make_unique<WiringPiGpio>();
+}
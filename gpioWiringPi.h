@@ -0,0 +1,38 @@
+/* ECEGRE-2020 - Seattle University
+   Description: wiringPi implementation of the GPIO backend
+   Authors: Brayton Alvarez and Paolo Saliba
+*/
+
+#include <condition_variable>
+#include <mutex>
+#include "gpio.h"
+
+#pragma once  // include only once
+
+// Number of BCM GPIO pins on the header
+#define WIRINGPI_PINS 28
+
+class WiringPiGpio : public GpioBackend
+{
+    private:
+        std::mutex edge_mutex;
+        std::condition_variable edge_cv;
+        int pending_edges;
+        bool isr_registered[WIRINGPI_PINS];
+
+        // wiringPi interrupt callbacks take no arguments, so they reach the
+        // backend through this pointer.
+        static WiringPiGpio *instance;
+        static void on_interrupt();
+
+    public:
+        // Sets up wiringPi with BCM pin numbers
+        WiringPiGpio();
+
+        void pin_mode(int pin, int mode) override;
+        void pull_up_dn(int pin, int pud) override;
+        void digital_write(int pin, int value) override;
+        int digital_read(int pin) override;
+        bool arm_edges(const int *pins, int count) override;
+        bool wait_edge(std::chrono::milliseconds timeout) override;
+};
@@ -0,0 +1,78 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Fixed-size log-linear latency histogram
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <bit>
+#include <cstdint>
+
+// Buckets per power of two. 8 keeps every bucket within 12.5% of its value.
+#define HISTOGRAM_SUB_BUCKETS 8
+#define HISTOGRAM_BUCKETS (64 * HISTOGRAM_SUB_BUCKETS)
+
+using namespace std;
+
+// Counts values (nanoseconds, usually) into buckets that grow with the
+// value, so recording is a few instructions with no allocation and the
+// percentiles keep their relative precision from nanoseconds to minutes.
+class LatencyHistogram {
+    private:
+        uint64_t buckets[HISTOGRAM_BUCKETS] = {};
+        uint64_t total = 0;
+        uint64_t sum = 0;
+        uint64_t largest = 0;
+
+        static int bucketOf(uint64_t value) {
+            if (value < HISTOGRAM_SUB_BUCKETS) return value;
+            int shift = bit_width(value) - 4;    // Keep the top 4 bits
+            return (shift + 1) * HISTOGRAM_SUB_BUCKETS + ((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+        }
+
+        // Largest value that falls in bucket b
+        static uint64_t bucketTop(int b) {
+            if (b < HISTOGRAM_SUB_BUCKETS) return b;
+            int shift = b / HISTOGRAM_SUB_BUCKETS - 1;
+            uint64_t low = uint64_t(HISTOGRAM_SUB_BUCKETS + b % HISTOGRAM_SUB_BUCKETS) << shift;
+            return low + ((uint64_t(1) << shift) - 1);
+        }
+
+    public:
+        void record(uint64_t value) {
+            buckets[bucketOf(value)]++;
+            total++;
+            sum += value;
+            if (value > largest) largest = value;
+        }
+
+        // Add the counts of another histogram (one per thread, merged at the end).
+        void merge(const LatencyHistogram &other) {
+            for (int b = 0; b < HISTOGRAM_BUCKETS; b++) buckets[b] += other.buckets[b];
+            total += other.total;
+            sum += other.sum;
+            if (other.largest > largest) largest = other.largest;
+        }
+
+        void clear() { *this = LatencyHistogram(); }
+
+        uint64_t count() const { return total; }
+        uint64_t max() const { return largest; }
+        double mean() const { return total ? double(sum) / total : 0; }
+
+        // Value below which the fraction p (0 to 1) of the samples fall,
+        // rounded up to the top of its bucket.
+        uint64_t percentile(double p) const {
+            if (total == 0) return 0;
+            uint64_t rank = uint64_t(p * total);
+            if (rank >= total) rank = total - 1;
+            uint64_t seen = 0;
+            for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+                seen += buckets[b];
+                if (seen > rank) return bucketTop(b) < largest ? bucketTop(b) : largest;
+            }
+            return largest;
+        }
+};
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,193 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Memory-mapped game journal, replayed to resume a game
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "gameRules.h"
+#include "journal.h"
+
+using namespace std;
+
+static const char JOURNAL_MAGIC[8] = {'B', 'S', 'J', 'R', 'N', 'L', '0', '1'};
+
+// First bytes of the file. Only an empty file is given one; a file with
+// another header is refused.
+struct JournalHeader {
+    char magic[8];
+    uint32_t recordSize;
+    uint32_t capacity;
+};
+
+GameJournal::GameJournal(const string &path) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) throw "Couldn't open journal file";
+
+    // One game per journal: a second client started in the same directory
+    // would otherwise take over this one's fleet and write into its records
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        throw "Journal in use by another game, pass -j <file> for another one";
+    }
+
+    // An empty file (or one just created) becomes a journal. Anything else
+    // must already be one, so a wrong -j never overwrites another file.
+    mapSize = JOURNAL_HEADER_SIZE + JOURNAL_RECORDS * sizeof(JournalRecord);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw "Couldn't size journal file";
+    }
+    // A file of the journal's size still all zeros was sized by an earlier
+    // open that stopped before writing the header
+    JournalHeader existing = {}, blank = {};
+    bool readable = st.st_size > 0 && pread(fd, &existing, sizeof(existing), 0) == (ssize_t)sizeof(existing);
+    bool fresh = st.st_size == 0 ||
+                 (readable && (size_t)st.st_size == mapSize && memcmp(&existing, &blank, sizeof(existing)) == 0);
+    if (!S_ISREG(st.st_mode) ||
+        (!fresh && (!readable || memcmp(existing.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 ||
+                    existing.recordSize != sizeof(JournalRecord) || existing.capacity != JOURNAL_RECORDS))) {
+        close(fd);
+        throw "Not a journal file, refusing to overwrite it";
+    }
+
+    // A journal cut short (by a full disk, say) is grown back with zeros
+    if ((size_t)st.st_size < mapSize && ftruncate(fd, mapSize) != 0) {
+        close(fd);
+        throw "Couldn't size journal file";
+    }
+
+    void *m = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) {
+        close(fd);
+        throw "Couldn't map journal file";
+    }
+    map = static_cast<char *>(m);
+    records = reinterpret_cast<JournalRecord *>(map + JOURNAL_HEADER_SIZE);
+
+    if (fresh) {
+        JournalHeader *header = reinterpret_cast<JournalHeader *>(map);
+        memcpy(header->magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+        header->recordSize = sizeof(JournalRecord);
+        header->capacity = JOURNAL_RECORDS;
+        dirty = true;
+        sync();
+    }
+
+    while (count < JOURNAL_RECORDS && records[count].seq == uint32_t(count + 1)) count++;
+}
+
+GameJournal::~GameJournal() {
+    sync();
+    munmap(map, mapSize);
+    close(fd);
+}
+
+bool GameJournal::append(int type, int a, int b, int c) {
+    if (count == JOURNAL_RECORDS) return false;
+    JournalRecord &rec = records[count];
+    rec.type = type;
+    rec.a = a;
+    rec.b = b;
+    rec.c = c;
+    // The record is complete before seq makes it part of the journal
+    atomic_ref<uint32_t>(rec.seq).store(count + 1, memory_order_release);
+    count++;
+    dirty = true;
+    return true;
+}
+
+void GameJournal::begin(const Board &myMap) {
+    // Invalidate the first record before clearing the rest, so a crash
+    // part way through leaves an empty journal rather than a mix
+    atomic_ref<uint32_t>(records[0].seq).store(0, memory_order_release);
+    memset(records, 0, JOURNAL_RECORDS * sizeof(JournalRecord));
+    count = 0;
+
+    append(JOURNAL_GAME);
+    for (int i = 0; i < FLEET_COUNT; i++) {
+        int size = myMap.shipSize[i];
+        if (size == 0) continue;
+        int first = 0;
+        for (int w = 0; w < BOARD_WORDS; w++) {
+            if (myMap.shipId[i].w[w]) {
+                first = w * 64 + countr_zero(myMap.shipId[i].w[w]);
+                break;
+            }
+        }
+        int row = first / GRID_SIZE, col = first % GRID_SIZE;
+        bool horizontal = size > 1 && col + 1 < GRID_SIZE && myMap.shipId[i].test(first + 1);
+        append(JOURNAL_SHIP, row, col, size | (horizontal ? 0x80 : 0));
+    }
+    sync();
+}
+
+void GameJournal::end() {
+    append(JOURNAL_END);
+    sync();
+}
+
+void GameJournal::sync() {
+    if (!dirty) return;
+    msync(map, mapSize, MS_SYNC);
+    dirty = false;
+}
+
+JournalReplay GameJournal::replay(Board &myMap, Board &oppMap,
+                                  const function<void(int, int, ShotResult, int)> &ownResult) const {
+    JournalReplay rep;
+    myMap.reset();
+    oppMap.reset();
+    int ships = 0;
+    for (int i = 0; i < count; i++) {
+        const JournalRecord &rec = records[i];
+        switch (rec.type) {
+            case JOURNAL_GAME:
+                rep = JournalReplay();
+                rep.inGame = true;
+                myMap.reset();
+                oppMap.reset();
+                ships = 0;
+                break;
+            case JOURNAL_SHIP:
+                if (ships < FLEET_COUNT) myMap.placeShip(ships++, shipMask(rec.a, rec.b, rec.c & 0x7F, rec.c & 0x80));
+                break;
+            case JOURNAL_START:
+                rep.started = true;
+                rep.myTurn = rec.a == 1;
+                break;
+            case JOURNAL_SHOT:
+                rep.shotPending = true;
+                rep.shotX = rec.a;
+                rep.shotY = rec.b;
+                break;
+            case JOURNAL_RESULT: {
+                ShotResult result = ShotResult(rec.a);
+                recordResult(oppMap, rep.shotX, rep.shotY, result);
+                if (ownResult) ownResult(rep.shotX, rep.shotY, result, rec.b);
+                rep.shotPending = false;
+                rep.resultsReceived++;
+                rep.myTurn = result == RESULT_HIT || result == RESULT_SUNK;
+                break;
+            }
+            case JOURNAL_INCOMING: {
+                // Shooting our own board again gives the same reply
+                rep.lastReplySunk = 0;
+                rep.lastReply = resolveShot(myMap, rec.a, rec.b, &rep.lastReplySunk);
+                rep.shotsAnswered++;
+                rep.myTurn = rep.lastReply == RESULT_MISS;
+                break;
+            }
+            case JOURNAL_END:
+                rep.inGame = false;
+                break;
+        }
+    }
+    rep.records = count;
+    return rep;
+}
@@ -0,0 +1,105 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Memory-mapped game journal, replayed to resume a game
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "board.h"
+#include "protocol.h"
+
+// Records the journal file holds, enough for the longest game
+#define JOURNAL_RECORDS 1024
+// Bytes before the first record
+#define JOURNAL_HEADER_SIZE 64
+// Milliseconds between flushes of the map to the file while playing
+#define JOURNAL_SYNC_MS 1000
+
+using namespace std;
+
+enum JournalType {
+    JOURNAL_GAME = 1,    // A new game begins, the ships follow
+    JOURNAL_SHIP,        // a: row, b: col, c: size, +0x80 if horizontal
+    JOURNAL_START,       // Paired, a: position from START
+    JOURNAL_SHOT,        // Our shot sent, a: x, b: y
+    JOURNAL_RESULT,      // Reply to our last shot, a: ShotResult, b: sunk size
+    JOURNAL_INCOMING,    // Opponent's shot answered, a: x, b: y, c: ShotResult
+    JOURNAL_END          // Game over
+};
+
+// One fixed size record. seq is written last: a record only counts when
+// seq is its position in the file plus one, so a record torn by a crash
+// ends the journal there.
+struct JournalRecord {
+    uint8_t type;
+    uint8_t a, b, c;
+    uint32_t seq;
+};
+
+// What replaying the journal recovered besides the two boards
+struct JournalReplay {
+    bool inGame = false;         // A game was begun and didn't end
+    bool started = false;        // and it got as far as START
+    bool myTurn = false;         // After START: we shoot next
+    bool shotPending = false;    // Our shot (shotX, shotY) has no reply yet
+    int shotX = 0, shotY = 0;
+    int shotsAnswered = 0;       // Opponent shots we replied to
+    int resultsReceived = 0;     // Our shots that got a reply
+    ShotResult lastReply = RESULT_NONE;  // Our reply to the last opponent shot
+    int lastReplySunk = 0;
+    int records = 0;
+};
+
+// Append-only journal of one game in a memory-mapped file: the fleet, then
+// every shot and result as they happen. Appending is a few stores into the
+// map, with no system call; sync() writes the dirty page back and is called
+// on a timer and when the game ends. After a crash or a lost connection the
+// journal is replayed to rebuild both boards and the turn.
+class GameJournal {
+    private:
+        int fd = -1;
+        char *map = nullptr;
+        size_t mapSize = 0;
+        JournalRecord *records = nullptr;
+        int count = 0;               // Valid records
+        bool dirty = false;
+
+    public:
+        // Opens or creates the file and locks it for this process. Throws if
+        // another process has it, if it is neither empty nor a journal (it is
+        // never overwritten) or if it can't be mapped.
+        GameJournal(const string &path);
+        ~GameJournal();
+
+        GameJournal(const GameJournal &) = delete;
+        GameJournal &operator=(const GameJournal &) = delete;
+
+        // Start a new game with the fleet on myMap, dropping the old one
+        void begin(const Board &myMap);
+
+        void start(int position)                          { append(JOURNAL_START, position); }
+        void shot(int x, int y)                           { append(JOURNAL_SHOT, x, y); }
+        void result(ShotResult result, int sunkSize)      { append(JOURNAL_RESULT, result, sunkSize); }
+        void incoming(int x, int y, ShotResult result)    { append(JOURNAL_INCOMING, x, y, result); }
+
+        // The game is over: nothing to resume
+        void end();
+
+        // Flush the map to the file if anything was appended since the last sync
+        void sync();
+
+        // Rebuild the boards from the journal. ownResult, if set, is called
+        // for each reply to our shots in order (to replay a shot strategy).
+        JournalReplay replay(Board &myMap, Board &oppMap,
+                             const function<void(int x, int y, ShotResult result, int sunkSize)> &ownResult = nullptr) const;
+
+        int size() const { return count; }
+
+    private:
+        bool append(int type, int a = 0, int b = 0, int c = 0);
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,87 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Lock-free single-producer/single-consumer queue of key events
+   Authors: Brayton Alvarez and Paolo Saliba
+*/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+#pragma once  // include only once
+
+// One key press or release as seen by the scanner thread
+struct KeyEvent
+{
+    char key;                                     // '0'-'9', '*' or '#'
+    std::chrono::steady_clock::time_point time;   // When the scan that settled it ran
+    bool pressed = true;                          // false for a release
+};
+
+// Ring of key events written by the scanner thread and read by one consumer.
+// Push and pop never lock. The mutex and condition variable are only used to
+// put the consumer to sleep when the ring is empty, and the producer only
+// touches them when a consumer is actually waiting.
+// N must be a power of two.
+template <std::size_t N>
+class KeyQueue
+{
+    private:
+        static_assert((N & (N - 1)) == 0, "KeyQueue size must be a power of two");
+
+        KeyEvent events[N];
+        alignas(64) std::atomic<std::size_t> head{0};   // Next slot to read
+        alignas(64) std::atomic<std::size_t> tail{0};   // Next slot to write
+        alignas(64) std::atomic<int> waiters{0};
+        std::mutex wait_mutex;
+        std::condition_variable wait_cv;
+
+    public:
+        // Producer: add an event, returns false if the ring is full
+        bool push(const KeyEvent &event) {
+            std::size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == N) return false;
+            events[t & (N - 1)] = event;
+            tail.store(t + 1, std::memory_order_seq_cst);
+
+            // Pairs with the waiter count in wait_for_event
+            if (waiters.load(std::memory_order_seq_cst) > 0) {
+                std::lock_guard<std::mutex> lock(wait_mutex);
+                wait_cv.notify_one();
+            }
+            return true;
+        }
+
+        // Consumer: take an event if one is queued
+        bool try_pop(KeyEvent &event) {
+            std::size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire)) return false;
+            event = events[h & (N - 1)];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer: wait up to timeout for an event
+        bool pop_for(KeyEvent &event, std::chrono::milliseconds timeout) {
+            if (try_pop(event)) return true;
+            std::unique_lock<std::mutex> lock(wait_mutex);
+            waiters.fetch_add(1, std::memory_order_seq_cst);
+            bool ready = wait_cv.wait_for(lock, timeout, [this] {
+                return head.load(std::memory_order_relaxed) != tail.load(std::memory_order_seq_cst);
+            });
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+            return ready && try_pop(event);
+        }
+
+        // Consumer: block until an event arrives
+        KeyEvent pop() {
+            KeyEvent event;
+            while (!pop_for(event, std::chrono::milliseconds(1000))) {}
+            return event;
+        }
+
+        bool empty() const {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+};
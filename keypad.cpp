@@ -4,7 +4,8 @@
 */
 
 #include <string>
-#include <wiringPi.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include "keypad.h"
 #include <chrono>
 #include <thread>
@@ -12,9 +13,11 @@
 using namespace std;
 using namespace std::chrono_literals;  // Allow use of 10ms and 0.1s literals
 
-Keypad::Keypad(int columnInPins[MAXCOL], int rowInPins[MAXROW]){
-    // Setup wiringPi
-    wiringPiSetupGpio();
+Keypad::Keypad(int columnInPins[MAXCOL], int rowInPins[MAXROW], GpioBackend &gpioBackend, bool edgeTriggered){
+    gpio = &gpioBackend;
+    edge_triggered = edgeTriggered;
+    get_key_thread = nullptr;
+    trace = nullptr;
     
     // Check for duplicate pin numbers
     for (int i = 0; i < MAXCOL; i++) {
@@ -43,97 +46,191 @@ Keypad::Keypad(int columnInPins[MAXCOL], int rowInPins[MAXROW]){
         else throw "Invalid Custom Row Pinout";
     }
 
-    // Initialize booleans
-    digit_ready = false;
+    column_mask = 0;
+    row_mask = 0;
+    for (int i = 0; i < MAXCOL; i++) column_mask |= uint32_t(1) << column[i];
+    for (int i = 0; i < MAXROW; i++) row_mask |= uint32_t(1) << row[i];
+
+    // Initialize state
+    for (int i = 0; i < MAXROW * MAXCOL; i++) keys[i] = {false, 0};
+    press_scans = KEY_PRESS_SCANS;
+    release_scans = KEY_RELEASE_SCANS;
+    scan_interval = std::chrono::microseconds(KEY_SCAN_US);
     is_stopped = true;
+    key_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+Keypad::~Keypad(){
+    stop();
+    if (key_fd >= 0) close(key_fd);
 }
 
 void Keypad::run(){
     // Start thread if not already running
     if (is_stopped) {
         try {
-            get_key_thread = new std::jthread(&Keypad::get_key, this);
             is_stopped = false;
+            get_key_thread = new std::jthread(&Keypad::get_key, this);
         } catch(...) {
+            is_stopped = true;
             cerr << "Couldn't start thread";
         }
     }
 }
 
-void Keypad::get_key() {
-    while(true) {
-        if (is_stopped) break;
-        
-        // Short delay at each loop iteration
-        this_thread::sleep_for(20ms);
-        
-        // Set column pins to output low
-        for (int i = 0; i < MAXCOL; i++) {
-            pinMode(this->column[i], OUTPUT);
-            digitalWrite(this->column[i], 0);
-        }
-        
-        // Set row pins to input with pull-up resistor
-        for (int i = 0; i < MAXROW; i++) {
-            pinMode(this->row[i], INPUT);
-            pullUpDnControl(this->row[i], PUD_UP);
+void Keypad::set_debounce(int pressScans, int releaseScans, std::chrono::microseconds interval){
+    if (pressScans < 1 || pressScans > 255 || releaseScans < 1 || releaseScans > 255) throw "Invalid Debounce Thresholds";
+    press_scans = pressScans;
+    release_scans = releaseScans;
+    scan_interval = interval;
+}
+
+void Keypad::idle_pins() {
+    // Set column pins to output low
+    gpio->set_modes(column_mask, GPIO_OUTPUT);
+    gpio->write_mask(column_mask, 0);
+    
+    // Set row pins to input (pulled up in get_key)
+    gpio->set_modes(row_mask, GPIO_INPUT);
+}
+
+uint32_t Keypad::scan() {
+    idle_pins();
+    
+    // Nothing held pulls a row low: the usual case, one read
+    if (gpio->read_mask(row_mask) == row_mask) return 0;
+    
+    // Columns to input (pulled up, so they float high), then drive one
+    // column low at a time: every row it pulls low has that key down
+    gpio->set_modes(column_mask, GPIO_INPUT);
+    uint32_t down = 0;
+    for (int c = 0; c < MAXCOL; c++) {
+        uint32_t driven = uint32_t(1) << this->column[c];
+        gpio->set_modes(driven, GPIO_OUTPUT);
+        gpio->write_mask(driven, 0);
+        uint32_t row_levels = gpio->read_mask(row_mask);
+        for (int r = 0; r < MAXROW; r++) {
+            if (!(row_levels & (uint32_t(1) << this->row[r]))) down |= uint32_t(1) << (r * MAXCOL + c);
         }
-        
-        // Check rows for a key press
-        int row_val = -1;
-        for (int i = 0; i < MAXROW; i++) {
-            if (digitalRead(this->row[i]) == 0) row_val = i;
+        gpio->set_modes(driven, GPIO_INPUT);
+    }
+    return down;
+}
+
+uint32_t Keypad::traced_scan() {
+    if (!trace) return scan();
+    uint64_t start = traceNow();
+    uint32_t down = scan();
+    trace->since(TRACE_KEY_SCAN, start);
+    return down;
+}
+
+uint32_t Keypad::ghost_keys(uint32_t down) {
+    uint32_t ghosts = 0;
+    for (int r1 = 0; r1 < MAXROW; r1++) {
+        for (int r2 = r1 + 1; r2 < MAXROW; r2++) {
+            for (int c1 = 0; c1 < MAXCOL; c1++) {
+                for (int c2 = c1 + 1; c2 < MAXCOL; c2++) {
+                    uint32_t corners = (uint32_t(1) << (r1 * MAXCOL + c1)) | (uint32_t(1) << (r1 * MAXCOL + c2)) |
+                                       (uint32_t(1) << (r2 * MAXCOL + c1)) | (uint32_t(1) << (r2 * MAXCOL + c2));
+                    if ((down & corners) == corners) ghosts |= corners;
+                }
+            }
         }
+    }
+    return ghosts;
+}
+
+bool Keypad::debounce_keys(uint32_t down) {
+    auto now = chrono::steady_clock::now();
+    
+    // A key that may be a phantom can't be pressed, but one already down stays down
+    uint32_t ghosts = ghost_keys(down);
+    bool idle = true;
+    for (int key = 0; key < MAXROW * MAXCOL; key++) {
+        KeyState &state = keys[key];
+        bool reads_down = (down >> key) & 1;
+        if (reads_down && !state.down && ((ghosts >> key) & 1)) reads_down = false;
         
-        // If no key was pressed, reset and continue
-        if (row_val < 0 || row_val >= MAXROW) {
-            this->last_digit = "";
-            this->digit_ready = false;
+        // Reads as it is: whatever was settling was a bounce
+        if (reads_down == state.down) {
+            state.count = 0;
+            idle &= !state.down;
             continue;
         }
+        idle = false;
+        if (++state.count < (state.down ? release_scans : press_scans)) continue;
         
-        // Set columns to input with pull-down resistor
-        for (int i = 0; i < MAXCOL; i++) {
-            pinMode(this->column[i], INPUT);
-            pullUpDnControl(this->column[i], PUD_DOWN);
-        }
-        
-        // Set the pressed row to output high
-        pinMode(this->row[row_val], OUTPUT);
-        digitalWrite(this->row[row_val], 1);
-        
-        // Determine which column was pressed
-        int col_val = -1;
-        for(int i = 0; i < MAXCOL; i++) {
-            if (digitalRead(this->column[i]) == 1) col_val = i;
-        }
+        // Read the other way for long enough: the key changed
+        state.down = reads_down;
+        state.count = 0;
+        queue_event(key, reads_down, now);
+        idle &= !state.down;
+    }
+    return idle;
+}
 
-        // If no valid column was found, reset and continue
-        if (col_val < 0 || col_val >= MAXCOL) {
-            this->last_digit = "";
-            this->digit_ready = false;
-            continue;
-        }
+void Keypad::queue_event(int key, bool pressed, chrono::steady_clock::time_point time) {
+    KeyEvent event;
+    event.key = KEYPAD[key / MAXCOL][key % MAXCOL][0];
+    event.time = time;
+    event.pressed = pressed;
+    if (!events.push(event)) cerr << "Keypad queue full, key dropped" << endl;
+    else if (key_fd >= 0) {
+        uint64_t one = 1;
+        if (write(key_fd, &one, sizeof(one)) < 0) {}  // Only fails if the counter is saturated
+    }
+}
+
+void Keypad::get_key() {
+    // The pulls only matter while a pin is an input, so they are set once:
+    // rows and columns up, so a pin reads low only through a key to the
+    // column being driven
+    gpio->set_pulls(row_mask | column_mask, GPIO_PUD_UP);
+    
+    // Fall back to polling if the backend cannot report edges
+    bool use_edges = edge_triggered && gpio->arm_edges(this->row, MAXROW);
+
+    bool idle = true;    // Every key up with nothing settling
+    while(true) {
+        if (is_stopped) break;
         
-        // Register the key press if one isn’t already pending
-        if (!this->digit_ready) {
-            this->digit_ready = true;
-            this->last_digit = KEYPAD[row_val][col_val];
+        if (use_edges && idle) {
+            // Wait with the rows armed until one is pulled low. A key already
+            // held when the rows are armed doesn't make an edge, so check first.
+            idle_pins();
+            gpio->arm_edges(this->row, MAXROW);
+            bool row_low = gpio->read_mask(row_mask) != row_mask;
+            if (!row_low && !gpio->wait_edge(100ms)) continue;  // Timeout so stop() is noticed
+            // Scan right away, then every scan_interval until all keys are up
         }
+        else this_thread::sleep_for(scan_interval);
+        
+        idle = debounce_keys(traced_scan());
     }
 }
 
 string Keypad::get_digit(){
-    // Loop until a digit becomes available, then return it
-    while(true){
-        if (this->digit_ready){
-            this->digit_ready = false;
-            string temp = last_digit;
-            last_digit = "";
-            return temp;
-        }
-        this_thread::sleep_for(0.15s);
-    }
+    KeyEvent event = events.pop();
+    while (!event.pressed) event = events.pop();
+    return string(1, event.key);
+}
+
+KeyEvent Keypad::get_event(){
+    return events.pop();
+}
+
+bool Keypad::try_get_event(KeyEvent &event, std::chrono::milliseconds timeout){
+    return events.pop_for(event, timeout);
+}
+
+bool Keypad::poll_event(KeyEvent &event){
+    return events.try_pop(event);
+}
+
+void Keypad::clear_event_fd(){
+    uint64_t count;
+    if (key_fd >= 0 && read(key_fd, &count, sizeof(count)) < 0) {}  // Nothing pending
 }
 
 // Safely stop the keypad thread
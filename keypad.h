@@ -6,6 +6,9 @@
 #include <string>
 #include <iostream>  // cerr
 #include <thread>    // jthread, this_thread::sleep_for, get_key_thread
+#include "gpio.h"    // GpioBackend
+#include "keyQueue.h" // KeyQueue, KeyEvent
+#include "trace.h"   // TraceRing
 
 #pragma once  // include only once
 
@@ -13,13 +16,24 @@
 #define MAXCOL 3
 #define MAXROW 4
 
+// Key events that can wait unread before new ones are dropped
+#define KEY_QUEUE_SIZE 64
+
+// Default debounce: a key must read the same for this many scans in a row
+// before a press or a release counts, with KEY_SCAN_US between scans
+#define KEY_SCAN_US 1000
+#define KEY_PRESS_SCANS 2
+#define KEY_RELEASE_SCANS 5
+
 using namespace std;
 
 class Keypad
 {
     private:
-        bool digit_ready;
         bool is_stopped;
+        bool edge_triggered;
+        int key_fd;                       // eventfd signalled on every queued press
+        GpioBackend* gpio;
         std::jthread* get_key_thread;
         const string KEYPAD[MAXROW][MAXCOL] = {
             {"1", "2", "3"},
@@ -29,21 +43,89 @@ class Keypad
         };
         int column[MAXCOL];
         int row[MAXROW];
-        string last_digit;
+        uint32_t column_mask;             // Column pins as a bit mask
+        uint32_t row_mask;                // Row pins as a bit mask
+        // Debounce state of one key. The key is up or down; count is how
+        // many scans in a row have read it the other way (a press or a
+        // release settling), 0 when it reads as it is.
+        struct KeyState {
+            bool down;
+            unsigned char count;
+        };
+        KeyState keys[MAXROW * MAXCOL];
+        int press_scans;                  // Scans down before a press counts
+        int release_scans;                // Scans up before a release counts
+        std::chrono::microseconds scan_interval;
+        KeyQueue<KEY_QUEUE_SIZE> events;  // Presses and releases waiting for the consumer
+        TraceRing* trace;                 // Scan times go here, if set
+
+        // Columns low, rows pulled up: a pressed key pulls its row low
+        void idle_pins();
+
+        // Queue a press or release of key (row * MAXCOL + col)
+        void queue_event(int key, bool pressed, std::chrono::steady_clock::time_point time);
+
+        // scan(), timed when tracing
+        uint32_t traced_scan();
 
     public:
-        // Constructor
-        Keypad(int columnInPins[MAXCOL], int rowInPins[MAXROW]);
+        // Constructor. With edge_triggered the scanner sleeps until a row
+        // sees a falling edge instead of scanning continuously, and scans
+        // only until every key is up again.
+        Keypad(int columnInPins[MAXCOL], int rowInPins[MAXROW], GpioBackend &gpioBackend, bool edgeTriggered = false);
         
+        // Record the time of each scan into ring. Call before run().
+        void set_trace(TraceRing* ring) { trace = ring; }
+
+        // Scans a key must read down (press) or up (release) in a row before
+        // the event is queued, and the time between scans. Contact bounce
+        // shorter than the thresholds never makes an event. Call before
+        // run(). Throws if a threshold is below 1 or above 255.
+        void set_debounce(int pressScans, int releaseScans, std::chrono::microseconds interval);
+
+        // Keys that may be phantoms in a scan: the matrix has no diodes, so
+        // three keys down at the corners of a rectangle make the fourth
+        // corner read as down too. Returns every corner of each such
+        // rectangle; a key among them is not pressed until it clears.
+        static uint32_t ghost_keys(uint32_t down);
+
         // Start the keypad thread
         void run(void);
         
         // Thread function to continuously check for key presses
         void get_key();
         
-        // Return the latest key digit
+        // Run every key through its debounce with the keys read down by a
+        // scan, queueing the presses and releases that settle. Returns true
+        // if every key is up with nothing settling. The keypad thread calls
+        // this after each scan; a caller can feed its own scans while the
+        // thread isn't running.
+        bool debounce_keys(uint32_t down);
+        
+        // Scan every key of the matrix once. Returns a bit per key read
+        // down (bit row * MAXCOL + col), before debouncing.
+        uint32_t scan();
+        
+        // Block until a key is pressed and return it (releases are skipped)
         string get_digit(void);
         
+        // Block until a key is pressed or released and return the event
+        // with its timestamp
+        KeyEvent get_event(void);
+        
+        // Wait up to timeout for a key event, returns false if none came
+        bool try_get_event(KeyEvent &event, std::chrono::milliseconds timeout);
+        
+        // Take a queued key event without waiting
+        bool poll_event(KeyEvent &event);
+        
+        // File descriptor that becomes readable when events are queued, for
+        // use with poll/epoll. Call clear_event_fd() before taking the events.
+        int event_fd() const { return key_fd; }
+        void clear_event_fd();
+        
+        ~Keypad();
+        
         // Stop the keypad thread
         void stop();
 };
@@ -0,0 +1,397 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Headless load driver, plays many games at once against a server
+   Authors: Paolo Saliba and Brayton Alvarez
+
+   Every session is a player like mygame, with the keypad replaced by a
+   ShotStrategy and the prompts and grid printing left out. Sessions are
+   paired two by two on a shared game id, so they play each other through
+   the server. Each driver thread runs its share of the sessions on its own
+   epoll loop. The driver reports
+   games per second and latency histograms for pairing (READY to START) and
+   for each shot (PLAY to RESULT), and the bytes and send() calls per shot.
+
+   Compilation:
+     g++ -std=c++20 -O2 -o loadDriver loadDriver.cpp relayServer.cpp protocol.cpp eventLoop.cpp -lpthread
+
+   Usage:
+     ./loadDriver [-a address] [-p port] [-l] [-n sessions] [-j threads] [-g games] [-d seconds] [-t strategy] [-s seed] [-T]
+       -a: server IP (default 127.0.0.1)
+       -p: server port (default 10000)
+       -l: start a reference server in this process and play against it
+       -n: number of sessions, rounded up to an even number (default 100)
+       -j: driver threads, each with its own event loop (default 1)
+       -g: games each session plays (default 10)
+       -d: stop after this many seconds instead, 0 for no limit (default 0)
+       -t: shot strategy, random, sweep or density (default random)
+       -s: seed for fleets and strategies (default random)
+       -T: text messages only, don't offer the binary records
+*/
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "board.h"
+#include "eventLoop.h"
+#include "fleetGenerator.h"
+#include "gameRules.h"
+#include "histogram.h"
+#include "protocol.h"
+#include "relayServer.h"
+#include "strategy.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// Receive buffer per session. Only short protocol lines are expected.
+#define DRIVER_LINE_SIZE 256
+// Period of the housekeeping timer: retries, progress and the time limit
+#define DRIVER_TICK_MS 100
+
+enum SessionState {
+    SESSION_RETRY,         // Not connected, try again on the next tick
+    SESSION_CONNECTING,
+    SESSION_AWAIT_START,
+    SESSION_AWAIT_RESULT,
+    SESSION_AWAIT_SHOT,
+    SESSION_DONE           // Played all its games
+};
+
+struct Session {
+    int id;
+    int sock = -1;
+    SessionState state = SESSION_RETRY;
+    BasicFrameReader<DRIVER_LINE_SIZE> reader;
+    Board myMap;
+    Board oppMap;
+    unique_ptr<ShotStrategy> strategy;
+    int round = 0;               // Games finished, also part of the game id
+    WireFormat wire;             // Agreed at START
+    SendQueue out;               // Flushed at the end of each socket event
+    int shotX = 0, shotY = 0;
+    Clock::time_point sentAt;    // When the message awaiting a reply went out
+};
+
+class LoadDriver {
+    private:
+        EventLoop &loop;
+        sockaddr_in serverAddress;
+        vector<unique_ptr<Session>> sessions;
+        FleetGenerator generator;
+        int gamesPerSession;
+        const char *caps;            // Announced in READY
+        int tickTimer;
+        Clock::time_point deadline;
+        bool timeLimited;
+        int sessionsDone = 0;
+
+    public:
+        uint64_t games = 0;          // Counted once, by the winner
+        uint64_t shots = 0;
+        uint64_t errors = 0;         // Connections lost or refused
+        uint64_t sends = 0;          // send() calls after START
+        uint64_t bytesSent = 0;      // and the bytes they carried
+        LatencyHistogram pairing;
+        LatencyHistogram shotRoundTrip;
+
+        // Runs sessions firstId to firstId + numSessions - 1. The ids decide
+        // the pairing, so give every driver an even firstId and count.
+        LoadDriver(EventLoop &eventLoop, const sockaddr_in &address, int firstId, int numSessions,
+                   int games, int seconds, const string &strategyName, uint64_t seed, bool textOnly)
+            : loop(eventLoop), serverAddress(address), generator(seed + firstId), gamesPerSession(games),
+              caps(textOnly ? CAP_SUNK : CAP_SUNK "+" CAP_BIN) {
+            for (int i = firstId; i < firstId + numSessions; i++) {
+                unique_ptr<Session> s = make_unique<Session>();
+                s->id = i;
+                s->strategy = makeStrategy(strategyName, seed + 1 + i, ClassicGame::fleet);
+                if (!s->strategy) throw "Unknown shot strategy";
+                sessions.push_back(move(s));
+            }
+            timeLimited = seconds > 0;
+            deadline = Clock::now() + chrono::seconds(seconds);
+            tickTimer = makeTimer();
+            loop.add(tickTimer, EPOLLIN, [this](uint32_t) { onTick(); });
+        }
+
+        ~LoadDriver() {
+            for (auto &s : sessions) {
+                if (s->sock >= 0) close(s->sock);
+            }
+            close(tickTimer);
+        }
+
+        void start() {
+            for (auto &s : sessions) connectSession(*s);
+            armTimer(tickTimer, chrono::milliseconds(DRIVER_TICK_MS), chrono::milliseconds(DRIVER_TICK_MS));
+        }
+
+    private:
+        void onTick() {
+            readTimer(tickTimer);
+            if (timeLimited && Clock::now() >= deadline) {
+                loop.stop();
+                return;
+            }
+            for (auto &s : sessions) {
+                if (s->state == SESSION_RETRY) connectSession(*s);
+            }
+        }
+
+        void connectSession(Session &s) {
+            s.sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (s.sock < 0) {
+                errors++;
+                s.state = SESSION_RETRY;
+                return;
+            }
+            // Replies are small and often followed by our next shot straight away
+            int one = 1;
+            setsockopt(s.sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            int rc = connect(s.sock, (struct sockaddr*)&serverAddress, sizeof(serverAddress));
+            if (rc != 0 && errno != EINPROGRESS) {
+                errors++;
+                close(s.sock);
+                s.sock = -1;
+                s.state = SESSION_RETRY;
+                return;
+            }
+            s.state = SESSION_CONNECTING;
+            s.reader = BasicFrameReader<DRIVER_LINE_SIZE>();
+            s.out.clear();
+            s.wire = WireFormat();
+            Session *sp = &s;
+            loop.add(s.sock, EPOLLIN | EPOLLOUT | EPOLLRDHUP, [this, sp](uint32_t events) { onSocket(*sp, events); });
+        }
+
+        void disconnect(Session &s) {
+            loop.remove(s.sock);
+            close(s.sock);
+            s.sock = -1;
+        }
+
+        void onSocket(Session &s, uint32_t /*events*/) {
+            if (s.state == SESSION_CONNECTING) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(s.sock, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0) {
+                    errors++;
+                    disconnect(s);
+                    s.state = SESSION_RETRY;
+                    return;
+                }
+                loop.modify(s.sock, EPOLLIN | EPOLLRDHUP);
+
+                // Sessions 2k and 2k+1 meet on the same game id every round
+                generator.generate(s.myMap, ClassicGame::fleet);
+                s.oppMap.reset();
+                s.strategy->reset();
+                char name[24], gameId[32];
+                snprintf(name, sizeof(name), "load%d", s.id);
+                snprintf(gameId, sizeof(gameId), "load-%d-%d", s.id / 2, s.round);
+                s.sentAt = Clock::now();
+                s.out.commit(formatReady(s.out.tail(), name, gameId, caps));
+                if (!s.out.flush(s.sock)) shutdown(s.sock, SHUT_RDWR);
+                s.state = SESSION_AWAIT_START;
+                return;
+            }
+
+            ssize_t n = s.reader.fill(s.sock);
+            Message msg;
+            while (s.sock >= 0 && nextMessage(s.reader, s.wire.binary, msg)) {
+                onMessage(s, msg);
+            }
+            if (s.sock >= 0) flush(s);
+            if (s.sock >= 0 && n <= 0 && !(n < 0 && errno == EAGAIN)) {
+                // Lost the server or the opponent mid game
+                errors++;
+                endGame(s);
+            }
+        }
+
+        void onMessage(Session &s, const Message &msg) {
+            if (s.state == SESSION_AWAIT_START && msg.type == MSG_START) {
+                pairing.record(elapsedNs(s.sentAt));
+                s.wire.negotiate(caps, msg.caps);
+                if (msg.position == 1) shoot(s);
+                else s.state = SESSION_AWAIT_SHOT;
+            }
+            else if (s.state == SESSION_AWAIT_RESULT && msg.type == MSG_RESULT) {
+                shotRoundTrip.record(elapsedNs(s.sentAt));
+                shots++;
+                recordResult(s.oppMap, s.shotX, s.shotY, msg.result);
+                s.strategy->onResult(s.shotX, s.shotY, msg.result);
+                if (msg.result == RESULT_SUNK) s.strategy->onSunk(s.shotX, s.shotY, msg.sunkSize);
+                if (msg.result == RESULT_WIN) {
+                    games++;
+                    endGame(s);
+                }
+                else if (isHit(msg.result)) shoot(s);
+                else s.state = SESSION_AWAIT_SHOT;
+            }
+            else if (s.state == SESSION_AWAIT_SHOT && msg.type == MSG_PLAY) {
+                if (msg.x >= GRID_SIZE || msg.y >= GRID_SIZE) return;
+                int sunkSize = 0;
+                ShotResult result = resolveShot(s.myMap, msg.x, msg.y, &sunkSize);
+                s.out.commit(s.wire.result(s.out.tail(), result, sunkSize));
+                if (result == RESULT_WIN) {
+                    flush(s);
+                    endGame(s);
+                }
+                else if (result == RESULT_MISS) shoot(s);
+            }
+        }
+
+        void shoot(Session &s) {
+            s.strategy->nextShot(s.oppMap, s.shotX, s.shotY);
+            s.sentAt = Clock::now();
+            s.out.commit(s.wire.play(s.out.tail(), s.shotX, s.shotY));
+            s.state = SESSION_AWAIT_RESULT;
+        }
+
+        // Send what the last event queued with one call
+        void flush(Session &s) {
+            if (s.out.empty()) return;
+            sends++;
+            bytesSent += SEND_QUEUE_SIZE - s.out.room();
+            if (!s.out.flush(s.sock)) {
+                // Picked up as a lost connection on the next read
+                shutdown(s.sock, SHUT_RDWR);
+            }
+        }
+
+        // Close the game's connection and start the next game, if any
+        void endGame(Session &s) {
+            disconnect(s);
+            s.round++;
+            if (s.round >= gamesPerSession) {
+                s.state = SESSION_DONE;
+                if (++sessionsDone == (int)sessions.size()) loop.stop();
+                return;
+            }
+            connectSession(s);
+        }
+
+        static uint64_t elapsedNs(Clock::time_point since) {
+            return chrono::duration_cast<chrono::nanoseconds>(Clock::now() - since).count();
+        }
+};
+
+static void printHistogram(const char *title, const LatencyHistogram &h) {
+    printf("%-16s n=%-9llu mean %8.1f  p50 %8.1f  p90 %8.1f  p99 %8.1f  p99.9 %8.1f  max %8.1f us\n",
+           title, (unsigned long long)h.count(), h.mean() / 1e3, h.percentile(0.5) / 1e3,
+           h.percentile(0.9) / 1e3, h.percentile(0.99) / 1e3, h.percentile(0.999) / 1e3, h.max() / 1e3);
+}
+
+int main(int argc, char *argv[])
+{
+    string address = "127.0.0.1";
+    int port = 10000;
+    bool local = false;
+    bool textOnly = false;
+    int numSessions = 100;
+    int numThreads = 1;
+    int games = 10;
+    int seconds = 0;
+    string strategy = "random";
+    uint64_t seed = (uint64_t(random_device{}()) << 32) | random_device{}();
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-l") local = true;
+        else if (arg == "-T") textOnly = true;
+        else if (i + 1 < argc) {
+            if (arg == "-a") address = argv[++i];
+            else if (arg == "-p") port = stoi(argv[++i]);
+            else if (arg == "-n") numSessions = stoi(argv[++i]);
+            else if (arg == "-j") numThreads = stoi(argv[++i]);
+            else if (arg == "-g") games = stoi(argv[++i]);
+            else if (arg == "-d") seconds = stoi(argv[++i]);
+            else if (arg == "-t") strategy = argv[++i];
+            else if (arg == "-s") seed = stoull(argv[++i]);
+        }
+    }
+    numSessions = max(2, numSessions + (numSessions & 1));
+    numThreads = max(1, min(numThreads, numSessions / 2));
+    if (seconds > 0) games = INT32_MAX;
+
+    // Two sockets per game, and the local server's as well
+    rlimit files;
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    try {
+        unique_ptr<RelayServer> server;
+        if (local) {
+            server = make_unique<RelayServer>(0);
+            server->start();
+            address = "127.0.0.1";
+            port = server->port();
+        }
+
+        sockaddr_in serverAddress = {};
+        serverAddress.sin_family = AF_INET;
+        serverAddress.sin_port = htons(port);
+        serverAddress.sin_addr.s_addr = inet_addr(address.c_str());
+
+        // Whole pairs per thread, so both players of a game share a loop
+        vector<unique_ptr<EventLoop>> loops;
+        vector<unique_ptr<LoadDriver>> drivers;
+        int pairs = numSessions / 2;
+        for (int t = 0, first = 0; t < numThreads; t++) {
+            int count = 2 * (pairs / numThreads + (t < pairs % numThreads ? 1 : 0));
+            loops.push_back(make_unique<EventLoop>());
+            drivers.push_back(make_unique<LoadDriver>(*loops[t], serverAddress, first, count,
+                                                      games, seconds, strategy, seed, textOnly));
+            first += count;
+        }
+
+        Clock::time_point started = Clock::now();
+        vector<thread> threads;
+        for (int t = 0; t < numThreads; t++) {
+            threads.emplace_back([&, t] {
+                drivers[t]->start();
+                loops[t]->run();
+            });
+        }
+        for (thread &t : threads) t.join();
+        double elapsed = chrono::duration<double>(Clock::now() - started).count();
+
+        uint64_t totalGames = 0, totalShots = 0, totalErrors = 0, totalSends = 0, totalBytes = 0;
+        LatencyHistogram pairing, shotRoundTrip;
+        for (auto &driver : drivers) {
+            totalGames += driver->games;
+            totalShots += driver->shots;
+            totalErrors += driver->errors;
+            totalSends += driver->sends;
+            totalBytes += driver->bytesSent;
+            pairing.merge(driver->pairing);
+            shotRoundTrip.merge(driver->shotRoundTrip);
+        }
+
+        printf("%d sessions, %llu games in %.2f s: %.1f games/s, %llu shots (%.0f shots/s), %llu errors\n",
+               numSessions, (unsigned long long)totalGames, elapsed, totalGames / elapsed,
+               (unsigned long long)totalShots, totalShots / elapsed, (unsigned long long)totalErrors);
+        printf("%s messages: %.2f bytes and %.2f sends per shot\n", textOnly ? "text" : "binary",
+               totalBytes / double(max<uint64_t>(1, totalShots)), totalSends / double(max<uint64_t>(1, totalShots)));
+        printHistogram("pairing", pairing);
+        printHistogram("shot round trip", shotRoundTrip);
+        if (server) printf("server: %s\n", server->report().c_str());
+    }
+    catch (const char *error) {
+        cerr << error << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -4,7 +4,8 @@
     This program implements a full two-player Battleship game.
     
     Each player generates a fleet on a 10x10 grid (using autogenFleet from genFleet.h)
-    and maintains a view of the opponent’s grid (initially unknown).
+    and maintains a view of the opponent’s grid (initially unknown). Both grids are
+    kept as packed bitboards (Board in board.h) rather than one string per cell.
     After the READY/START handshake with the server, the players alternate turns:
     
       - On your turn, you enter your shot’s X and Y coordinates using the keypad.
@@ -13,24 +14,107 @@
             "PLAY,RESULT,HIT\r\n"  if the shot hit a ship,
             "PLAY,RESULT,WIN\r\n"  if that shot sunk their final ship,
          or "PLAY,RESULT,MISS\r\n" if the shot missed.
+        If both players announce BIN in READY, these are sent as 3 byte
+        binary records instead (protocol.h).
       - After each shot, the current player grid and the opponent’s grid view are displayed.
       - In the display, on your own grid ships are shown as solid squares,
         hits as "X" and misses as "o".  
         On the opponent grid, unknown cells show as "?", misses appear as blank,
         and hits are shown as a white square (□, Unicode U+25A1).
       - The game ends when all ships of one player are sunk.
+
+    The client runs on one epoll loop (eventLoop.h): the server socket, the
+    keypad's event fd, Ctrl+C (signalfd) and the reconnect timer (timerfd)
+    are all events, and GameClient is a state machine that reacts to them.
+
+    The fleet and every shot are written to a journal file (journal.h). If
+    the connection drops mid game the client reconnects and carries on;
+    if it is stopped or crashes, starting it again resumes the game. When
+    both players resume they exchange RESUME to agree on the last shot.
+
+    With -g the game is a large event game instead: a grid of up to
+    1000000 x 1000000 cells with thousands of ships (-f), kept as sparse
+    boards (sparseBoard.h) whose memory grows with the ships and shots, not
+    with the grid. Coordinates take as many keypad digits as the grid needs,
+    both players must announce the same GRID=<size> in READY, and the grid
+    is summarized instead of drawn. These games aren't journaled.
+
+    With -p the client times each step of a turn (trace.h): the keypad scan,
+    the wakeup when a key is taken, keypress to send, send to result and
+    result to drawn frame, and keeps a histogram of each.
+
+    Startup runs in parallel: the keypad's GPIO setup starts on its own
+    thread at launch, fleets come from a pool filled in the background
+    (fleetPool.h), and the connection starts right after the prompts,
+    retrying with a growing back-off. The client prints how long it took
+    from the prompts until it was ready to play. With -m it plays that many
+    games in a row, taking a new fleet from the pool for each rematch.
+
+    With -l and -c two clients play without the server: one listens, the
+    other connects, and each answers the other's READY as the server would
+    with START (the listener moves first). The address is a TCP
+    "host:port" or a UNIX socket path, so two bots on one machine skip the
+    TCP stack.
+
+    With -w the client publishes the boards, the turn and every shot into
+    a shared-memory segment (spectator.h), for spectate.cpp or any other
+    local reader. It costs a few dozen stores per shot and readers never
+    hold the game up.
       
     Compilation:
-      g++ -std=c++20 -o mygame mygame.cpp genFleet.cpp keypad.cpp -lwiringPi -lpthread
+      g++ -std=c++20 -o mygame mygame.cpp keypad.cpp gpioWiringPi.cpp protocol.cpp eventLoop.cpp render.cpp journal.cpp trace.cpp fleetPool.cpp spectator.cpp -lwiringPi -lpthread -lrt
+    Without wiringPi, gpioMmap.cpp maps /dev/gpiomem instead (GPIO_BCM2711=1 on a Pi 4):
+      g++ -std=c++20 -o mygame mygame.cpp keypad.cpp gpioMmap.cpp protocol.cpp eventLoop.cpp render.cpp journal.cpp trace.cpp fleetPool.cpp spectator.cpp -lpthread -lrt
+    Off the Pi, gpioMock.cpp in place of gpioWiringPi.cpp (and no -lwiringPi).
+
+    Usage:
+      ./mygame [-s seed] [-r] [-a] [-b microseconds] [-t] [-j file] [-n] [-p file] [-g size] [-f ships] [-m games]
+              [-l address | -c address] [-w name]
+        -s: fixed seed for a reproducible fleet layout
+        -r: keep both grids at the top of the screen and redraw only the
+            cells that changed (faster on slow serial or SSH consoles)
+        -a: autoplay, shots are chosen by the targeting engine (targeting.h)
+            instead of the keypad
+        -b: time the targeting engine may spend per shot (default 200)
+        -t: text messages only, don't offer the binary records
+        -j: journal file (default mygame.journal)
+        -n: start a new game even if the journal holds an unfinished one
+        -p: trace turn latency; the report is written to file on exit and
+            on SIGUSR1, and sent to every connection on file.sock
+        -g: large event game on a size x size grid (up to 1000000)
+        -f: ships in the fleet of a large event game, the classic sizes in
+            equal shares (default 7, up to 100000)
+        -m: games to play against the same opponent (default 1)
+        -l: play direct, waiting for the opponent on address: ":port" or
+            "host:port" for TCP (port 10000 if none), "unix:<path>" or a
+            path with a '/' for a UNIX socket
+        -c: play direct, connecting to the opponent listening on address
+        -w: publish the game for spectators in the shared-memory segment name
 */
 
 #include "genFleet.h"    // Fleet generation functions and print routines
+#include "board.h"       // Bitboard game state
+#include "sparseBoard.h" // Interval-indexed state for large event boards
+#include "fleetGenerator.h"  // Seedable fleet generator
+#include "protocol.h"    // Framed message reader and parser
+#include "gameRules.h"   // Shot resolution shared with the load driver
 #include "keypad.h"      // Keypad interface (runs in the background)
+#include "gpio.h"        // GPIO backend for the keypad, chosen at link time
+#include "eventLoop.h"   // epoll loop, timerfd and signalfd helpers
+#include "render.h"      // Frame-buffered grid renderer
+#include "strategy.h"    // Autoplay shot selection
+#include "journal.h"     // Game journal for resuming
+#include "trace.h"       // Turn latency tracing
+#include "fleetPool.h"   // Fleets generated ahead of time
+#include "spectator.h"   // Shared-memory feed for spectators
+#include <cerrno>
 #include <cstring>
 #include <iostream>
 #include <netinet/in.h>
-#include <arpa/inet.h>   // for inet_addr()
+#include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
 #include <unistd.h>
 #include <string>
 #include <csignal>
@@ -40,159 +124,810 @@
 #include <sstream>
 #include <limits>
 #include <cctype>
+#include <memory>
+#include <vector>
 
 using namespace std;
 
-// Check if all ships in the grid are sunk.
-// A cell is considered part of a ship if it is not " " and not marked as hit ("X") or miss ("o").
-bool allShipsSunk(const string (&grid)[GRID_SIZE][GRID_SIZE]) {
-    for (int i = 0; i < GRID_SIZE; i++) {
-        for (int j = 0; j < GRID_SIZE; j++) {
-            if (grid[i][j] != " " && grid[i][j] != "X" && grid[i][j] != "o")
-                return false;
+// Reads a coordinate from keypad presses, one key at a time. Digits are
+// taken while the number stays within 0..maxValue, so on the classic grid
+// that is one digit. The user is required to press '#' to confirm the
+// number, and may use '*' to delete the last digit if needed.
+struct CoordinateEntry {
+    string input;
+    int maxValue = GRID_SIZE - 1;
+
+    // Feed one key. Returns true once a number has been submitted with '#'.
+    bool onKey(char key, int &value) {
+        if (key == '#') {
+            // Submit: only accept if a digit was entered.
+            if (input.empty()) return false;
+            value = number();
+            input.clear();
+            cout << endl;
+            return true;
+        }
+        else if (key == '*') {
+            // Backspace: remove the last digit if one exists.
+            if (!input.empty()) {
+                input.pop_back();
+                cout << "\b \b" << flush;
+            }
+        }
+        else if (key >= '0' && key <= '9') {
+            // Only accept a digit that keeps the number on the grid (and no
+            // digits after a leading zero).
+            if (input != "0" && number() * 10 + (key - '0') <= maxValue) {
+                input += key;
+                cout << key << flush;
+            }
         }
+        // Other keys (if any) are simply ignored.
+        return false;
     }
-    return true;
-}
 
-// Helper to parse a comma-delimited message.
-string getFromBuffer(string& s_buff, string del) {
-    string ret_str;
-    size_t pos = s_buff.find(del);
-    if (pos != string::npos) {
-        ret_str = s_buff.substr(0, pos);
-        s_buff.erase(0, pos + del.length());
-    } else {
-        ret_str = s_buff;
-        s_buff = "";
+    // The digits entered so far, at most SPARSE_MAX_SIZE
+    int number() const {
+        int n = 0;
+        for (char c : input) n = n * 10 + (c - '0');
+        return n;
     }
-    return ret_str;
-}
+};
 
-// Global flag and signal handler to gracefully exit.
-volatile sig_atomic_t running = 1;
-void signalHandler(int signum) {
-    cout << "\nExiting... " << flush;
-    running = 0;
-}
+// Both boards of a large event game (-g), used instead of the bitboards
+struct SparseGame {
+    SparseBoard mine;
+    SparseBoard opp;
+    vector<unsigned short> fleet;
+    FleetGenerator generator;    // Our fleet, again for each rematch
+    SparseHuntStrategy *autoplay = nullptr;
+};
 
-// Read a one-digit number from the keypad. The user is required to press '#' to confirm
-// the digit, and may use '*' to delete the digit if needed.
-int getCoordinateFromKeypad(Keypad &kp, const string &prompt) {
-    cout << prompt << flush;
-    string input = "";
-    while (true) {
-        string key = kp.get_digit();  // Blocks until a key is pressed
+// When each part of startup finished, for the time-to-ready report. The
+// keypad setup, the fleet and the connection run at the same time.
+struct StartupTimes {
+    using clock = chrono::steady_clock;
+    clock::time_point launch = clock::now();   // main() entered
+    clock::time_point prompted;                // Name and server IP answered
+    clock::time_point keypadReady;             // GPIO set up and keypad scanning
+    clock::time_point readySent;               // Connected and READY sent
+    chrono::microseconds fleetTime{0};         // Getting our fleet
+    bool reported = false;
 
-        if (key == "#") {
-            // Submit: only accept if exactly one digit was entered.
-            if (!input.empty()) {
-                break;
+    static double ms(clock::duration d) { return chrono::duration<double, milli>(d).count(); }
+
+    // Print the time to ready once both the keypad and the connection are
+    void report() {
+        if (reported || keypadReady == clock::time_point() || readySent == clock::time_point()) return;
+        reported = true;
+        cout << "Ready " << ms(max(keypadReady, readySent) - prompted) << " ms after the prompts (keypad "
+             << ms(keypadReady - launch) << " ms after launch, fleet " << fleetTime.count() << " us, connected "
+             << ms(readySent - prompted) << " ms after the prompts)." << endl;
+    }
+};
+
+// Milliseconds between attempts to reach the server: the first retry comes
+// quickly, then the wait doubles up to CONNECT_RETRY_MS
+#define CONNECT_RETRY_MIN_MS 100
+#define CONNECT_RETRY_MS 5000
+
+// Port of the relay server, and of a direct game when the address has none
+#define SERVER_PORT 10000
+
+// Where the client is in the game. Every event (socket data, key press,
+// timer, signal) moves it from one state to the next.
+enum ClientState {
+    STATE_CONNECTING,     // Non-blocking connect in progress or waiting to retry
+    STATE_AWAIT_START,    // READY sent, waiting to be paired
+    STATE_AWAIT_RESUME,   // Resuming, waiting for the opponent's RESUME
+    STATE_ENTER_X,        // Our turn, reading the X coordinate from the keypad
+    STATE_ENTER_Y,        // Our turn, reading the Y coordinate from the keypad
+    STATE_AWAIT_RESULT,   // Shot sent, waiting for HIT/MISS/WIN
+    STATE_AWAIT_SHOT,     // Opponent's turn
+    STATE_GAME_OVER
+};
+
+// How the client reaches its opponent
+enum PeerMode {
+    PEER_SERVER,    // Through the relay server, which pairs players by game id
+    PEER_CONNECT,   // Straight to an opponent listening for us
+    PEER_LISTEN     // The opponent connects straight to us
+};
+
+// One game against the server or a direct opponent, driven entirely by the
+// event loop.
+class GameClient {
+    private:
+        EventLoop &loop;
+        Keypad *kp = nullptr;        // Set by attachKeypad() once its setup has finished
+        SpectatorFeed *spectators = nullptr;  // Set by attachSpectators(), or none
+        GridRenderer &renderer;
+        ShotStrategy *autoplay;      // Chooses shots instead of the keypad, or nullptr
+        GameJournal *journal;        // nullptr for large event games, which aren't journaled
+        TraceRing *trace;            // Turn timings, or nullptr when not tracing
+        JournalReplay resume;        // Where the journal left the game
+        Board &myMap;
+        Board oppMap;
+        SparseGame *sparse;          // Large event game, or nullptr for the classic grid
+        FleetPool *pool;             // Fleets for rematches on the classic grid
+        StartupTimes *startup;       // Told when READY first goes out
+        int gamesLeft;               // This game and the rematches after it
+        string userName;
+        string myGameId;
+        string myCaps;               // Capabilities announced in READY
+        PeerMode mode;
+        SocketAddress peerAddress;   // The server, the opponent or where we listen
+
+        ClientState state = STATE_CONNECTING;
+        int sock = -1;
+        int listenSock = -1;         // PEER_LISTEN only
+        int retryTimer;
+        int retryDelay = CONNECT_RETRY_MIN_MS;
+        int syncTimer = -1;
+        FrameReader reader;
+        SendQueue out;               // Flushed at the end of each event
+        WireFormat wire;             // Agreed at START
+        CoordinateEntry entry;
+        int shotX = 0, shotY = 0;
+
+        // Trace timestamps (traceNow), 0 when not set
+        uint64_t keyAt = 0;          // Scan of the key that confirmed the shot
+        uint64_t sentAt = 0;         // Shot handed to the socket
+        uint64_t receivedAt = 0;     // Last read from the socket
+        bool shotQueued = false;     // The send queue holds our shot
+
+    public:
+        GameClient(EventLoop &eventLoop, GridRenderer &gridRenderer, ShotStrategy *strategy, GameJournal *gameJournal,
+                   TraceRing *traceRing, Board &fleet, SparseGame *sparseGame, FleetPool *fleetPool, StartupTimes *times,
+                   int games, const string &name, const string &gameId, const string &caps, PeerMode peerMode,
+                   const SocketAddress &address)
+            : loop(eventLoop), renderer(gridRenderer), autoplay(strategy), journal(gameJournal), trace(traceRing),
+              myMap(fleet), sparse(sparseGame), pool(fleetPool), startup(times), gamesLeft(games), userName(name),
+              myGameId(gameId), myCaps(caps), mode(peerMode), peerAddress(address) {
+            entry.maxValue = gridSize() - 1;
+            replayJournal();
+            retryTimer = makeTimer();
+            loop.add(retryTimer, EPOLLIN, [this](uint32_t) {
+                readTimer(retryTimer);
+                if (state == STATE_GAME_OVER) rematch();
+                else connectToServer();
+            });
+            // The journal is written with plain stores, flush it now and then
+            if (journal) {
+                syncTimer = makeTimer();
+                loop.add(syncTimer, EPOLLIN, [this](uint32_t) {
+                    readTimer(syncTimer);
+                    journal->sync();
+                });
+                armTimer(syncTimer, chrono::milliseconds(JOURNAL_SYNC_MS), chrono::milliseconds(JOURNAL_SYNC_MS));
             }
-            // If no digit was entered yet, ignore '#' and continue.
-        } 
-        else if (key == "*") {
-            // Backspace: remove the digit if one exists.
-            if (!input.empty()) {
-                input.clear();
-                // Optionally update the console display (backspace)
-                cout << "\b \b" << flush;
+        }
+
+        ~GameClient() {
+            if (sock >= 0) close(sock);
+            if (listenSock >= 0) {
+                close(listenSock);
+                if (peerAddress.isUnix()) unlinkSocketFile(peerAddress.path);
             }
-        } 
-        else if (key >= "0" && key <= "9") {
-            // Only accept a digit if no digit has been entered yet.
-            if (input.empty()) {
-                input = key;
-                cout << key << flush;
+            close(retryTimer);
+            if (syncTimer >= 0) close(syncTimer);
+        }
+
+        // Take key presses from keypad from now on
+        void attachKeypad(Keypad &keypad) {
+            kp = &keypad;
+            loop.add(kp->event_fd(), EPOLLIN, [this](uint32_t) { onKeys(); });
+        }
+
+        // Publish the game to spectators from now on
+        void attachSpectators(SpectatorFeed &feed) {
+            spectators = &feed;
+            publishState(SPECTATE_WAITING);
+        }
+
+        // Start the first connection attempt, or start listening for the
+        // opponent. Returns false if we can't listen on the address.
+        bool start() {
+            if (mode == PEER_LISTEN) {
+                listenSock = listenOn(peerAddress, 4);
+                if (listenSock < 0) return false;
+                loop.add(listenSock, EPOLLIN, [this](uint32_t) { onAccept(); });
             }
-            // If a digit is already present, ignore additional numeric keys.
+            cout << connectingText() << flush;
+            connectToServer();
+            return true;
         }
-        // Other keys (if any) are simply ignored.
-    }
-    cout << endl;
-    return stoi(input);
-}
 
+        bool finished() const { return state == STATE_GAME_OVER; }
 
+        // Display final grids.
+        void printFinal() const {
+            if (sparse) {
+                cout << endl;
+                printStatus();
+                cout << "\nGame Over." << endl;
+                return;
+            }
+            cout << "\nFinal Your Grid:" << endl;
+            printPlayerGrid(myMap);
+            cout << "\nFinal Opponent Grid:" << endl;
+            printOpponentGrid(oppMap);
+            cout << "\nGame Over." << endl;
+        }
 
-// Print the player's own grid.
-// Ships (cells that are not " " and not hit/miss) are shown as a solid square (■),
-// hits as "X", and misses as "o".
-void printPlayerGrid(const string (&grid)[GRID_SIZE][GRID_SIZE]) {
-    cout << "   ";
-    for (int i = 0; i < GRID_SIZE; i++){
-         cout << i << " ";
-    }
-    cout << "\n   ";
-    for (int i = 0; i < GRID_SIZE; i++){
-         cout << "--";
-    }
-    cout << "\n";
-    for (int r = 0; r < GRID_SIZE; r++) {
-       cout << r << "| ";
-       for (int c = 0; c < GRID_SIZE; c++){
-          string cell = grid[r][c];
-          if(cell == "X") {
-              cout << "X ";
-          } else if(cell == "o") {
-              cout << "o ";
-          } else if(cell != " ") {
-              cout << "\u25A0" << " ";  // White square for ship parts
-          } else {
-              cout << "  ";
-          }
-       }
-       cout << "\n";
-    }
-}
+    private:
+        const char *connectingText() const {
+            switch (mode) {
+                case PEER_CONNECT: return "Connecting to opponent...";
+                case PEER_LISTEN:  return "Waiting for the opponent to connect...";
+                default:           return "Connecting to server...";
+            }
+        }
 
-// Print the opponent's grid.
-// Unknown cells are shown as "?", misses as blank, and hits as a white square (□, Unicode U+25A1).
-void printOpponentGrid(const string (&grid)[GRID_SIZE][GRID_SIZE]) {
-    cout << "   ";
-    for (int i = 0; i < GRID_SIZE; i++){
-         cout << i << " ";
-    }
-    cout << "\n   ";
-    for (int i = 0; i < GRID_SIZE; i++){
-         cout << "--";
-    }
-    cout << "\n";
-    for (int r = 0; r < GRID_SIZE; r++) {
-       cout << r << "| ";
-       for (int c = 0; c < GRID_SIZE; c++){
-          string cell = grid[r][c];
-          if(cell == "X") {
-              cout << "\u25A0" << " ";  // White square for hits
-          } else if(cell == "o") {
-              cout << "  "; // Misses are blank
-          } else {
-              cout << "? ";
-          }
-       }
-       cout << "\n";
-    }
-}
+        void connectToServer() {
+            if (sock >= 0) {
+                loop.remove(sock);
+                close(sock);
+                sock = -1;
+            }
+            if (mode == PEER_LISTEN) return;    // onAccept() takes it from here
+            sock = makeStreamSocket(peerAddress);
+            if (sock < 0) {
+                cerr << "Socket creation error" << endl;
+                endGame();
+                return;
+            }
+            int rc = connect(sock, peerAddress.get(), peerAddress.length);
+            if (rc != 0 && errno != EINPROGRESS) {
+                // Try again later
+                close(sock);
+                sock = -1;
+                retryLater();
+                return;
+            }
+            // Writable once the connect has finished, one way or the other
+            loop.add(sock, EPOLLIN | EPOLLOUT | EPOLLRDHUP, [this](uint32_t events) { onSocket(events); });
+        }
 
-// Display both grids.
-void displayGrids(const string (&myGrid)[GRID_SIZE][GRID_SIZE], const string (&oppGrid)[GRID_SIZE][GRID_SIZE]) {
-    cout << "\nYour Grid:" << endl;
-    printPlayerGrid(myGrid);
-    cout << "\nOpponent Grid:" << endl;
-    printOpponentGrid(oppGrid);
-    cout << endl;
-}
+        // The opponent connected to us. Only one at a time: anyone else is
+        // turned away while a game is on.
+        void onAccept() {
+            int fd = accept4(listenSock, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            if (state != STATE_CONNECTING || sock >= 0) {
+                close(fd);
+                return;
+            }
+            if (!peerAddress.isUnix()) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+            sock = fd;
+            loop.add(sock, EPOLLIN | EPOLLOUT | EPOLLRDHUP, [this](uint32_t events) { onSocket(events); });
+        }
+
+        void onSocket(uint32_t events) {
+            if (state == STATE_CONNECTING) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0) {
+                    loop.remove(sock);
+                    close(sock);
+                    sock = -1;
+                    retryLater();
+                    return;
+                }
+                cout << "Connected!" << endl;
+                retryDelay = CONNECT_RETRY_MIN_MS;
+                loop.modify(sock, EPOLLIN | EPOLLRDHUP);
+
+                // Send the READY command to the server, or straight to the
+                // opponent, who sends us theirs.
+                // A game that got as far as START is resumed with the opponent
+                string caps = resume.started ? myCaps + "+" CAP_RESUME : myCaps;
+                sendText("READY," + userName + "," + myGameId + "," + caps + "\r\n");
+                cout << (mode == PEER_SERVER ? "Waiting to be paired..." : "Waiting for the opponent's READY...") << endl;
+                state = STATE_AWAIT_START;
+                publishState(SPECTATE_WAITING);
+                if (startup && !startup->reported) {
+                    startup->readySent = chrono::steady_clock::now();
+                    startup->report();
+                }
+                return;
+            }
+
+            if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                ssize_t n = reader.fill(sock);
+                if (trace) receivedAt = traceNow();
+                Message msg;
+                while (state != STATE_GAME_OVER && nextMessage(reader, wire.binary, msg)) {
+                    onMessage(msg);
+                }
+                // Replies and shots made while handling them go out together
+                flushQueue();
+                if (n <= 0 && !(n < 0 && errno == EAGAIN) && state != STATE_GAME_OVER) {
+                    cerr << connectionErrorText() << endl;
+                    if (resume.started) reconnect();
+                    else endGame();
+                }
+            }
+        }
+
+        const char *connectionErrorText() const {
+            switch (state) {
+                case STATE_AWAIT_START:  return "Connection error while waiting for pairing.";
+                case STATE_AWAIT_RESULT: return "Connection error during shot result.";
+                default:                 return "Connection error while waiting for opponent's shot.";
+            }
+        }
+
+        void onMessage(const Message &msg) {
+            if (state == STATE_AWAIT_START && msg.type == MSG_START && mode == PEER_SERVER) {
+                onStart(msg.position, msg.name, msg.caps);
+            }
+            else if (state == STATE_AWAIT_START && msg.type == MSG_READY && mode != PEER_SERVER) {
+                // Playing direct, the opponent's READY stands in for START.
+                // The one who listened moves first, like the one who waited
+                // on the server.
+                if (msg.gameId != myGameId) {
+                    cerr << "The opponent is playing game " << msg.gameId << "." << endl;
+                    endGame();
+                    return;
+                }
+                onStart(mode == PEER_LISTEN ? 1 : 2, msg.name, msg.caps);
+            }
+            else if (state == STATE_AWAIT_RESUME && msg.type == MSG_RESUME) {
+                onResume(msg.answered, msg.received);
+            }
+            else if (state == STATE_AWAIT_RESULT && msg.type == MSG_RESULT) {
+                handleResult(msg.result, msg.sunkSize);
+            }
+            else if (state == STATE_AWAIT_SHOT && msg.type == MSG_PLAY) {
+                if (msg.x >= gridSize() || msg.y >= gridSize()) {
+                    cerr << "Ignoring shot outside the grid." << endl;
+                    return;
+                }
+                handleShot(msg.x, msg.y);
+            }
+        }
+
+        // Paired: position 1 moves first. caps are the opponent's.
+        void onStart(int position, string_view opponent, string_view caps) {
+            cout << "Paired with opponent: " << opponent << endl;
+            if (capabilityValue(caps, CAP_GRID) != capabilityValue(myCaps, CAP_GRID)) {
+                cerr << "The opponent plays on a different grid." << endl;
+                endGame();
+                return;
+            }
+            wire.negotiate(myCaps, caps);
+            if (spectators) spectators->startGame(opponent);
+            if (resume.started) {
+                if (hasCapability(caps, CAP_RESUME)) {
+                    // Both sides have the game, compare where each one is
+                    cout << "Resuming the game." << endl;
+                    out.commit(wire.resume(queueSpace(), resume.shotsAnswered, resume.resultsReceived));
+                    state = STATE_AWAIT_RESUME;
+                    return;
+                }
+                // The opponent starts over, so do we, with the same fleet
+                cout << "Opponent started a new game." << endl;
+                journal->begin(myMap);
+                replayJournal();
+            }
+            if (journal) journal->start(position);
+            resume.started = true;
+            // According to the protocol, player in position "1" starts first.
+            if (position == 1) {
+                cout << "You start first." << endl;
+                promptShot();
+            } else {
+                cout << "Opponent starts first. Wait for their move." << endl;
+                awaitShot();
+            }
+        }
+
+        // Rebuild both boards (and the autoplay strategy) from the journal
+        void replayJournal() {
+            if (!journal) return;
+            if (autoplay) autoplay->reset();
+            resume = journal->replay(myMap, oppMap, [this](int x, int y, ShotResult result, int sunkSize) {
+                if (!autoplay) return;
+                autoplay->onResult(x, y, result);
+                if (result == RESULT_SUNK) autoplay->onSunk(x, y, sunkSize);
+            });
+        }
+
+        // The opponent's RESUME: it answered `answered` of our shots and got
+        // `received` of our replies. A difference of one means the last
+        // message in that direction was lost and is sent again.
+        void onResume(int answered, int received) {
+            if (((resume.shotsAnswered - received) & 0xFF) == 1) {
+                out.commit(wire.result(queueSpace(), resume.lastReply, resume.lastReplySunk));
+            }
+            drawGrids();
+            if (resume.shotPending) {
+                shotX = resume.shotX;
+                shotY = resume.shotY;
+                if (((answered - resume.resultsReceived) & 0xFF) == 0) {
+                    out.commit(wire.play(queueSpace(), shotX, shotY));
+                }
+                cout << "Waiting for the result of the shot at (" << shotX << ", " << shotY << ")..." << endl;
+                state = STATE_AWAIT_RESULT;
+            }
+            else if (resume.myTurn) promptShot();
+            else awaitShot();
+        }
+
+        // The connection dropped mid game: start over from the journal and
+        // connect again. The opponent, cut off as well, does the same.
+        void reconnect() {
+            journal->sync();
+            replayJournal();
+            loop.remove(sock);
+            close(sock);
+            sock = -1;
+            reader = FrameReader();
+            out.clear();
+            wire = WireFormat();    // Text until the next START
+            state = STATE_CONNECTING;
+            cout << "Reconnecting..." << flush;
+            retryLater();
+        }
+
+        // Try to connect again after the current back-off, and double it
+        void retryLater() {
+            armTimer(retryTimer, chrono::milliseconds(retryDelay));
+            retryDelay = min(retryDelay * 2, CONNECT_RETRY_MS);
+        }
+
+        // Play again: a fresh fleet (ready in the pool), empty boards and a
+        // new connection, paired again by game id
+        void rematch() {
+            printFinal();
+            cout << "\nRematch, " << gamesLeft << (gamesLeft == 1 ? " game" : " games") << " to go." << endl;
+            if (sparse) {
+                sparse->generator.generate(sparse->mine, sparse->fleet);
+                sparse->opp.reset(sparse->opp.size);
+                if (sparse->autoplay) sparse->autoplay->reset();
+            } else {
+                pool->take(myMap);
+                oppMap.reset();
+                if (autoplay) autoplay->reset();
+            }
+            if (journal) journal->begin(myMap);
+            resume = JournalReplay();
+            loop.remove(sock);
+            close(sock);
+            sock = -1;
+            reader = FrameReader();
+            out.clear();
+            wire = WireFormat();
+            sentAt = keyAt = 0;
+            state = STATE_CONNECTING;
+            cout << connectingText() << flush;
+            connectToServer();
+        }
 
-int main()
+        // Prompt for shot coordinates using keypad only.
+        // With autoplay the strategy picks the shot and it is sent right away.
+        void promptShot() {
+            publishState(SPECTATE_MY_TURN);
+            if (sparse && sparse->autoplay) {
+                sparse->autoplay->nextShot(sparse->opp, shotX, shotY);
+                cout << "Your turn. Autoplay chose (" << shotX << ", " << shotY << ")." << endl;
+                submitShot();
+                return;
+            }
+            if (autoplay) {
+                autoplay->nextShot(oppMap, shotX, shotY);
+                cout << "Your turn. Autoplay chose (" << shotX << ", " << shotY << ")." << endl;
+                submitShot();
+                return;
+            }
+            cout << "Your turn. Enter shot coordinates.(# to enter shot, * to delete)" << endl;
+            cout << "Enter X coordinate (0-" << gridSize() - 1 << "): " << flush;
+            entry.input.clear();
+            state = STATE_ENTER_X;
+        }
+
+        void awaitShot() {
+            publishState(SPECTATE_THEIR_TURN);
+            cout << "Waiting for opponent's shot..." << endl;
+            state = STATE_AWAIT_SHOT;
+        }
+
+        void onKeys() {
+            kp->clear_event_fd();
+            KeyEvent event;
+            while (kp->poll_event(event)) {
+                if (!event.pressed) continue;    // Only presses enter digits
+                if (trace) trace->since(TRACE_KEY_WAKEUP, traceTime(event.time));
+                if (state == STATE_ENTER_X) {
+                    if (entry.onKey(event.key, shotX)) {
+                        cout << "Enter Y coordinate (0-" << gridSize() - 1 << "): " << flush;
+                        state = STATE_ENTER_Y;
+                    }
+                }
+                else if (state == STATE_ENTER_Y) {
+                    if (entry.onKey(event.key, shotY)) {
+                        keyAt = traceTime(event.time);
+                        submitShot();
+                    }
+                }
+                // Keys pressed while it isn't our turn are ignored.
+            }
+            flushQueue();
+        }
+
+        void submitShot() {
+            // Loop until a coordinate that hasn't been shot at is chosen.
+            if (sparse ? sparse->opp.isShot(shotY, shotX) : oppMap.isShot(shotY, shotX)) {
+                cout << "You've already shot at (" << shotX << ", " << shotY << "). Please choose different coordinates." << endl;
+                cout << "Enter X coordinate (0-" << gridSize() - 1 << "): " << flush;
+                state = STATE_ENTER_X;
+                return;
+            }
+
+            // Queue the shot command: "PLAY,x,y\r\n" or its binary record
+            if (journal) journal->shot(shotX, shotY);
+            char *text = queueSpace();
+            out.commit(wire.play(text, shotX, shotY));
+            shotQueued = true;
+            cout << "Shot sent at (" << shotX << ", " << shotY << "). Waiting for result..." << endl;
+            state = STATE_AWAIT_RESULT;
+        }
+
+        void handleResult(ShotResult result, int sunkSize) {
+            if (trace && sentAt) trace->record(TRACE_SEND_TO_RESULT, receivedAt - sentAt);
+            sentAt = 0;
+            if (journal) journal->result(result, sunkSize);
+            if (sparse) {
+                recordResult(sparse->opp, shotX, shotY, result);
+                if (sparse->autoplay) sparse->autoplay->onResult(shotX, shotY, result);
+            } else {
+                recordResult(oppMap, shotX, shotY, result);
+            }
+            if (autoplay) {
+                autoplay->onResult(shotX, shotY, result);
+                if (result == RESULT_SUNK) autoplay->onSunk(shotX, shotY, sunkSize);
+            }
+            if (spectators) spectators->shot(true, shotX, shotY, result, sunkSize);
+            if (isHit(result)) {
+                cout << "Your shot hit the enemy ship!" << endl;
+                if (result == RESULT_SUNK) {
+                    cout << "You sank a ship of size " << sunkSize << "!" << endl;
+                }
+                if (result == RESULT_WIN) {
+                    cout << "All enemy ships sunk. You win!" << endl;
+                    publishState(SPECTATE_WON);
+                    gameOver();
+                    return;
+                }
+            } else {
+                cout << "Your shot missed." << endl;
+            }
+            // Display grids after processing the shot.
+            drawGrids();
+            if (trace) trace->since(TRACE_RESULT_TO_FRAME, receivedAt);
+            // A hit gives you another turn.
+            if (result == RESULT_HIT || result == RESULT_SUNK) promptShot();
+            else awaitShot();
+        }
+
+        void handleShot(int x, int y) {
+            cout << "Opponent shot at (" << x << ", " << y << ")." << endl;
+            // Process the shot on your grid.
+            int sunkSize = 0;
+            ShotResult result = sparse ? resolveShot(sparse->mine, x, y, &sunkSize) : resolveShot(myMap, x, y, &sunkSize);
+            if (journal) journal->incoming(x, y, result);
+            char *text = queueSpace();
+            out.commit(wire.result(text, result, sunkSize));
+            if (spectators) spectators->shot(false, x, y, result, sunkSize);
+            if (result == RESULT_WIN) {
+                cout << "Your ship was hit!" << endl;
+                cout << "All your ships have been sunk. You lose." << endl;
+                publishState(SPECTATE_LOST);
+                gameOver();
+                return;
+            }
+            if (result == RESULT_HIT || result == RESULT_SUNK) {
+                cout << "Your ship was hit!" << endl;
+                if (result == RESULT_SUNK) cout << "Your ship of size " << sunkSize << " was sunk." << endl;
+                drawGrids();
+                awaitShot();
+            } else {
+                cout << "Opponent missed." << endl;
+                drawGrids();
+                promptShot();
+            }
+        }
+
+        void sendText(const string &text) {
+            if (send(sock, text.c_str(), text.length(), MSG_NOSIGNAL) != (ssize_t)text.length()) {
+                cerr << "Failed to send to server." << endl;
+            }
+        }
+
+        // Room for one more message in the send queue
+        char *queueSpace() {
+            if (out.room() < MESSAGE_TEXT_SIZE) flushQueue();
+            return out.tail();
+        }
+
+        void flushQueue() {
+            bool sent = out.flush(sock);
+            if (!sent) cerr << "Failed to send to server." << endl;
+            if (!shotQueued) return;
+            shotQueued = false;
+            if (trace && sent) {
+                sentAt = traceNow();
+                // Autoplay shots have no key press
+                if (keyAt) trace->record(TRACE_KEY_TO_SEND, sentAt - keyAt);
+            }
+            keyAt = 0;
+        }
+
+        // Cells a side of the grid played on
+        int gridSize() const { return sparse ? sparse->mine.size : GRID_SIZE; }
+
+        // A large event grid is far too big to draw, print where the game stands
+        void printStatus() const {
+            cout << "Your fleet: " << sparse->mine.shipsAfloat() << " of " << sparse->mine.ships.size()
+                 << " ships afloat, hit " << sparse->mine.hits.size() << " times. Your shots: "
+                 << sparse->opp.hits.size() << " hits, " << sparse->opp.misses.size() << " misses." << endl;
+        }
+
+        // Hand the boards and the turn to spectators, if any
+        void publishState(SpectatePhase phase) {
+            if (!spectators) return;
+            if (sparse) spectators->publish(phase, sparse->mine, sparse->opp);
+            else spectators->publish(phase, myMap, oppMap);
+        }
+
+        // Draw both grids, timing it when tracing
+        void drawGrids() {
+            if (sparse) {
+                printStatus();
+                return;
+            }
+            if (!trace) {
+                renderer.draw(myMap, oppMap);
+                return;
+            }
+            uint64_t start = traceNow();
+            renderer.draw(myMap, oppMap);
+            trace->since(TRACE_RENDER, start);
+        }
+
+        void endGame() {
+            state = STATE_GAME_OVER;
+            loop.stop();
+        }
+
+        // The game was won or lost. A rematch starts once the last reply
+        // has been sent, from the retry timer.
+        void gameOver() {
+            if (journal) journal->end();
+            if (--gamesLeft == 0) {
+                endGame();
+                return;
+            }
+            state = STATE_GAME_OVER;
+            armTimer(retryTimer, chrono::milliseconds(1));
+        }
+};
+
+// Sets up the GPIO and the keypad on a thread of its own, started at launch
+// so it overlaps the prompts, the fleet and the connection. The event loop
+// hears it has finished on done (an eventfd) and then starts the keypad.
+class KeypadSetup {
+    public:
+        unique_ptr<GpioBackend> gpio;
+        unique_ptr<Keypad> kp;
+        const char *error = nullptr;
+        chrono::steady_clock::time_point finished;
+        int done;
+
+    private:
+        jthread worker;
+
+    public:
+        KeypadSetup() {
+            done = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            worker = startQuietThread([this] {
+                int colPins[3] = {21, 20, 16};
+                int rowPins[4] = {19, 13, 6, 5};
+                try {
+                    gpio = make_gpio_backend();
+                    kp = make_unique<Keypad>(colPins, rowPins, *gpio, true);  // Edge triggered: scan only when a row falls
+                }
+                catch (const char *message) {
+                    error = message;
+                }
+                finished = chrono::steady_clock::now();
+                uint64_t one = 1;
+                if (write(done, &one, sizeof(one)) < 0) {}  // Can't fail on a fresh eventfd
+            });
+        }
+
+        ~KeypadSetup() {
+            wait();
+            if (kp) kp->stop();
+            close(done);
+        }
+
+        // Wait for the setup thread, after which gpio, kp and error are set
+        void wait() {
+            if (worker.joinable()) worker.join();
+        }
+};
+
+int main(int argc, char *argv[])
 {
-    // Setup Ctrl+C signal handler.
-    signal(SIGINT, signalHandler);
+    // Optional "-s <seed>" gives a reproducible fleet layout,
+    // "-r" redraws only the cells that changed instead of both grids,
+    // "-a" plays automatically, "-b <us>" is its time per move,
+    // "-t" keeps to the text protocol, "-j <file>" names the journal,
+    // "-n" starts a new game instead of resuming the one in it,
+    // "-p <file>" traces turn latency into file, "-g <size>" with
+    // "-f <ships>" plays a large event game and "-m <games>" plays that
+    // many games in a row. "-l <address>" waits for the opponent to
+    // connect straight to us and "-c <address>" connects straight to them.
+    // "-w <name>" publishes the game in shared memory for spectators.
+    StartupTimes startup;
+    FleetGenerator generator;
+    RenderMode renderMode = RENDER_FULL;
+    bool autoplayOn = false;
+    bool textOnly = false;
+    int budgetUs = TARGETING_BUDGET_US;
+    string journal_path = "mygame.journal";
+    bool newGame = false;
+    string trace_path;
+    int large_size = 0;
+    int large_ships = FLEET_COUNT;
+    int games = 1;
+    PeerMode peerMode = PEER_SERVER;
+    string peer_address;
+    string spectate_name;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-r") renderMode = RENDER_DIFF;
+        else if (arg == "-a") autoplayOn = true;
+        else if (arg == "-t") textOnly = true;
+        else if (arg == "-n") newGame = true;
+        else if (arg == "-j" && i + 1 < argc) journal_path = argv[++i];
+        else if (arg == "-p" && i + 1 < argc) trace_path = argv[++i];
+        else if (arg == "-s" && i + 1 < argc) generator.seed(stoull(argv[++i]));
+        else if (arg == "-b" && i + 1 < argc) budgetUs = stoi(argv[++i]);
+        else if (arg == "-g" && i + 1 < argc) large_size = stoi(argv[++i]);
+        else if (arg == "-f" && i + 1 < argc) large_ships = stoi(argv[++i]);
+        else if (arg == "-m" && i + 1 < argc) games = max(1, stoi(argv[++i]));
+        else if (arg == "-w" && i + 1 < argc) spectate_name = argv[++i];
+        else if (arg == "-l" && i + 1 < argc) {
+            peerMode = PEER_LISTEN;
+            peer_address = argv[++i];
+        }
+        else if (arg == "-c" && i + 1 < argc) {
+            peerMode = PEER_CONNECT;
+            peer_address = argv[++i];
+        }
+    }
+    if (large_size && (large_size < 2 || large_size > SPARSE_MAX_SIZE || large_ships < 1 || large_ships > SPARSE_MAX_SHIPS)) {
+        cerr << "A large grid is 2 to " << SPARSE_MAX_SIZE << " cells a side with 1 to " << SPARSE_MAX_SHIPS << " ships" << endl;
+        return 1;
+    }
+    
+    // Start what doesn't need the prompts right away: the keypad's GPIO
+    // setup and, on the classic grid, a pool of fleets for this game and
+    // every rematch
+    const auto &fleet = ClassicGame::fleet;
+    KeypadSetup keypad;
+    unique_ptr<FleetPool> pool;
+    if (!large_size) pool = make_unique<FleetPool>(generator.engine()(), fleet);
     
     string server_ip;
     string user_name;
-    string opponent = "";
-    string player_pos;
-    string game_id;
     
     // Set your game ID (must match between players).
     string my_game_id = "BattleshipGame";
@@ -200,198 +935,184 @@ int main()
     // Get player name and server IP.
     cout << "Enter your name > ";
     getline(cin, user_name);
-    cout << "Enter server IP > ";
-    getline(cin, server_ip);
-    
-    // Generate your own fleet on a 10x10 grid.
-    string myMap[GRID_SIZE][GRID_SIZE];
-    resetFleet(myMap);
-    const unsigned short fleet[FLEET_COUNT] = {5,4,3,3,2,2,2};
-    autogenFleet(myMap, fleet);
+    if (peerMode == PEER_SERVER) {
+        cout << "Enter server IP > ";
+        getline(cin, server_ip);
+    }
+    else server_ip = peer_address;
+    SocketAddress serverAddress;
+    if (!parseSocketAddress(server_ip, SERVER_PORT, serverAddress) ||
+        (peerMode == PEER_SERVER && serverAddress.isUnix())) {
+        cerr << "Not an address: " << server_ip << endl;
+        return 1;
+    }
+    startup.prompted = chrono::steady_clock::now();
     
-    // Create an opponent grid view (initially unknown).
-    string oppMap[GRID_SIZE][GRID_SIZE];
-    for (int i = 0; i < GRID_SIZE; i++) {
-        for (int j = 0; j < GRID_SIZE; j++) {
-            oppMap[i][j] = " ";
+    // Resume the game in the journal, or take your fleet on a 10x10 grid
+    // from the pool and start a new one. A large event game gets a sparse
+    // fleet and no journal.
+    unique_ptr<GameJournal> journal;
+    unique_ptr<SparseGame> sparse;
+    Board myMap, oppMap;
+    auto fleetStart = chrono::steady_clock::now();
+    auto fleetTaken = [&] {
+        startup.fleetTime = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - fleetStart);
+    };
+    if (large_size) {
+        sparse = make_unique<SparseGame>();
+        sparse->mine.reset(large_size);
+        sparse->opp.reset(large_size);
+        sparse->fleet = sparseFleet(large_ships);
+        sparse->generator.seed(generator.engine()());
+        try {
+            sparse->generator.generate(sparse->mine, sparse->fleet);
+            fleetTaken();
+        }
+        catch (const char *error) {
+            cerr << error << endl;
+            return 1;
+        }
+        cout << "\nYour Fleet: " << large_ships << " ships on a " << large_size << "x" << large_size << " grid." << endl;
+    } else {
+        try {
+            journal = make_unique<GameJournal>(journal_path);
+        }
+        catch (const char *error) {
+            cerr << error << endl;
+            return 1;
+        }
+
+        fleetStart = chrono::steady_clock::now();
+        JournalReplay saved = journal->replay(myMap, oppMap);
+        fleetTaken();
+        auto replayTime = startup.fleetTime;
+        if (saved.inGame && !newGame) {
+            cout << "\nResuming the game in " << journal_path << " (" << saved.records << " records replayed in "
+                 << replayTime.count() << " us)." << endl;
+        } else {
+            fleetStart = chrono::steady_clock::now();
+            pool->take(myMap);
+            fleetTaken();
+            journal->begin(myMap);
         }
+
+        // Display your initial fleet.
+        cout << "\nYour Fleet:" << endl;
+        printPlayerGrid(myMap);
     }
     
-    // Display your initial fleet.
-    cout << "\nYour Fleet:" << endl;
-    printPlayerGrid(myMap);
-    
-    // Setup the keypad (if connected).
-    int colPins[3] = {21, 20, 16};
-    int rowPins[4] = {19, 13, 6, 5};
-    Keypad kp(colPins, rowPins);
-    kp.run();
-    
-    // Create a TCP socket and connect to the server.
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) {
-        cerr << "Socket creation error" << endl;
+    // Ctrl+C (and SIGUSR1, which dumps the trace) arrives through the event
+    // loop. Block it before the keypad thread starts so that thread
+    // inherits the mask (the setup and pool threads block every signal).
+    unique_ptr<Tracer> tracer;
+    if (!trace_path.empty()) tracer = make_unique<Tracer>();
+    int sigfd = tracer ? makeSignalFd({SIGINT, SIGTERM, SIGUSR1}) : makeSignalFd({SIGINT, SIGTERM});
+    if (sigfd < 0) {
+        cerr << "Couldn't set up signal handling" << endl;
         return 1;
     }
-    sockaddr_in serverAddress;
-    serverAddress.sin_family = AF_INET;
-    serverAddress.sin_port = htons(10000);
-    serverAddress.sin_addr.s_addr = inet_addr(server_ip.c_str());
     
-    cout << "Connecting to server..." << flush;
-    while (connect(sock, (struct sockaddr*)&serverAddress, sizeof(serverAddress)) != 0) {
-        if (!running) break;
-        this_thread::sleep_for(chrono::seconds(5));
+    // Both players use the same fleet, so the targeting engine assumes ours
+    unique_ptr<ShotStrategy> autoplay;
+    unique_ptr<SparseHuntStrategy> sparseAutoplay;
+    if (autoplayOn && sparse) {
+        sparseAutoplay = make_unique<SparseHuntStrategy>(generator.engine()());
+        sparse->autoplay = sparseAutoplay.get();
+    }
+    else if (autoplayOn) {
+        autoplay = make_unique<DensityStrategy>(fleet, generator.engine()(), chrono::microseconds(budgetUs));
     }
-    cout << "Connected!" << endl;
     
-    // Send the READY command to the server.
-    string readyMsg = "READY," + user_name + "," + my_game_id + "\r\n";
-    send(sock, readyMsg.c_str(), readyMsg.length(), 0);
-    cout << "Waiting to be paired..." << endl;
+    EventLoop loop;
+    GridRenderer renderer(STDOUT_FILENO, renderMode);
+    // Binary records have one byte per coordinate
+    string caps = (textOnly || large_size > BIN_MAX_GRID) ? CAP_SUNK : CAP_SUNK "+" CAP_BIN;
+    if (large_size) caps += "+" CAP_GRID "=" + to_string(large_size);
+    GameClient client(loop, renderer, autoplay.get(), journal.get(), tracer ? tracer->attach() : nullptr, myMap,
+                      sparse.get(), pool.get(), &startup, games, user_name, my_game_id, caps, peerMode,
+                      serverAddress);
     
-    // Wait for the START command.
-    char buffer[1024] = {0};
-    int bytesReceived = recv(sock, buffer, sizeof(buffer), 0);
-    if (bytesReceived <= 0) {
-        cerr << "Connection error while waiting for pairing." << endl;
-        return 1;
+    unique_ptr<SpectatorFeed> spectators;
+    if (!spectate_name.empty()) {
+        try {
+            spectators = make_unique<SpectatorFeed>(spectate_name, user_name, large_size ? large_size : GRID_SIZE,
+                                                    large_size ? large_ships : FLEET_COUNT);
+        }
+        catch (const char *error) {
+            cerr << error << endl;
+            return 1;
+        }
+        client.attachSpectators(*spectators);
     }
-    string startMsg(buffer);
-    // Expected format: "START,<position>,<opponent name>,<game id>\r\n"
-    string token = getFromBuffer(startMsg, ","); // "START"
-    player_pos = getFromBuffer(startMsg, ",");     // "1" or "2"
-    opponent = getFromBuffer(startMsg, ",");         // opponent name
-    game_id = getFromBuffer(startMsg, "\r");           // game id
     
-    cout << "Paired with opponent: " << opponent << endl;
-    // According to the protocol, player in position "1" starts first.
-    bool myTurn = (player_pos == "1");
-    if (myTurn) {
-        cout << "You start first." << endl;
-    } else {
-        cout << "Opponent starts first. Wait for their move." << endl;
-    }
+    // Start the keypad (if connected) once its setup has finished
+    loop.add(keypad.done, EPOLLIN, [&](uint32_t) {
+        loop.remove(keypad.done);
+        keypad.wait();
+        if (keypad.error) {
+            cerr << keypad.error << endl;
+            loop.stop();
+            return;
+        }
+        if (tracer) keypad.kp->set_trace(tracer->attach());
+        keypad.kp->run();
+        client.attachKeypad(*keypad.kp);
+        startup.keypadReady = keypad.finished;
+        startup.report();
+    });
+    loop.add(sigfd, EPOLLIN, [&](uint32_t) {
+        signalfd_siginfo info;
+        ssize_t n = read(sigfd, &info, sizeof(info));
+        if (n > 0 && info.ssi_signo == SIGUSR1) {
+            tracer->collect();
+            if (!tracer->writeFile(trace_path)) cerr << "Couldn't write " << trace_path << endl;
+            return;
+        }
+        if (n > 0) cout << "\nExiting... " << flush;
+        loop.stop();
+    });
     
-    bool gameOver = false;
-    while (!gameOver && running) {
-        if (myTurn) {
-            
-            // Prompt for shot coordinates using keypad only.
-            cout << "Your turn. Enter shot coordinates.(# to enter shot, * to delete)" << endl;
-            int shotX, shotY;
-            // Loop until a coordinate that hasn't been shot at is chosen.
-            while (true) {
-                shotX = getCoordinateFromKeypad(kp, "Enter X coordinate (0-9): ");
-                shotY = getCoordinateFromKeypad(kp, "Enter Y coordinate (0-9): ");
-                if (oppMap[shotY][shotX] != " ") {
-                    cout << "You've already shot at (" << shotX << ", " << shotY << "). Please choose different coordinates." << endl;
-                } else {
-                    break;
-                }
-            }
-            
-            // Send the shot command: "PLAY,x,y\r\n"
-            string shotCmd = "PLAY," + to_string(shotX) + "," + to_string(shotY) + "\r\n";
-            send(sock, shotCmd.c_str(), shotCmd.length(), 0);
-            cout << "Shot sent at (" << shotX << ", " << shotY << "). Waiting for result..." << endl;
-            
-            // Wait for the result from the opponent.
-            memset(buffer, 0, sizeof(buffer));
-            bytesReceived = recv(sock, buffer, sizeof(buffer), 0);
-            if (bytesReceived <= 0) {
-                cerr << "Connection error during shot result." << endl;
-                break;
-            }
-            string resultMsg(buffer);
-            // Expected response: "PLAY,RESULT,<result>\r\n"
-            token = getFromBuffer(resultMsg, ","); // "PLAY"
-            string secondToken = getFromBuffer(resultMsg, ","); // should be "RESULT"
-            string result = "";
-            if(secondToken == "RESULT"){
-                result = getFromBuffer(resultMsg, "\r");
-            }
-            
-            if (result == "HIT" || result == "WIN") {
-                oppMap[shotY][shotX] = "X";
-                cout << "Your shot hit the enemy ship!" << endl;
-                if (result == "WIN") {
-                    cout << "All enemy ships sunk. You win!" << endl;
-                    gameOver = true;
-                    break;
-                }
-                // A hit gives you another turn.
-                myTurn = true;
-            } else if (result == "MISS") {
-                oppMap[shotY][shotX] = "o";
-                cout << "Your shot missed." << endl;
-                myTurn = false;
-            }
-            // Display grids after processing the shot.
-            displayGrids(myMap, oppMap);
-        } else {
-            // Opponent's turn: wait for a shot command.
-            cout << "Waiting for opponent's shot..." << endl;
-            memset(buffer, 0, sizeof(buffer));
-            bytesReceived = recv(sock, buffer, sizeof(buffer), 0);
-            if (bytesReceived <= 0) {
-                cerr << "Connection error while waiting for opponent's shot." << endl;
-                break;
-            }
-            string shotMsg(buffer);
-            // Expected format: "PLAY,x,y\r\n"
-            token = getFromBuffer(shotMsg, ","); // "PLAY"
-            string secondToken = getFromBuffer(shotMsg, ",");
-            int shotX = 0, shotY = 0;
-            if(secondToken == "RESULT"){
-                continue;
-            } else {
-                shotX = stoi(secondToken);
-                string sy = getFromBuffer(shotMsg, "\r");
-                shotY = stoi(sy);
-            }
-            
-            cout << "Opponent shot at (" << shotX << ", " << shotY << ")." << endl;
-            // Process the shot on your grid.
-            string cell = myMap[shotY][shotX];
-            string response;
-            if (cell != " " && cell != "X" && cell != "o") {
-                // It's a hit.
-                myMap[shotY][shotX] = "X";
-                cout << "Your ship was hit!" << endl;
-                if (allShipsSunk(myMap)) {
-                    response = "PLAY,RESULT,WIN\r\n";
-                    send(sock, response.c_str(), response.length(), 0);
-                    cout << "All your ships have been sunk. You lose." << endl;
-                    gameOver = true;
-                    break;
-                } else {
-                    response = "PLAY,RESULT,HIT\r\n";
-                    send(sock, response.c_str(), response.length(), 0);
-                }
-                myTurn = false;
-            } else {
-                // It's a miss.
-                if (myMap[shotY][shotX] == " ")
-                    myMap[shotY][shotX] = "o";
-                cout << "Opponent missed." << endl;
-                response = "PLAY,RESULT,MISS\r\n";
-                send(sock, response.c_str(), response.length(), 0);
-                myTurn = true;
-            }
-            // Display grids after processing the shot.
-            displayGrids(myMap, oppMap);
+    // The trace is collected from the rings once a second, and on demand
+    int collectTimer = -1, traceSocket = -1;
+    string socket_path = trace_path + ".sock";
+    if (tracer) {
+        collectTimer = makeTimer();
+        loop.add(collectTimer, EPOLLIN, [&](uint32_t) {
+            readTimer(collectTimer);
+            tracer->collect();
+        });
+        armTimer(collectTimer, chrono::milliseconds(TRACE_COLLECT_MS), chrono::milliseconds(TRACE_COLLECT_MS));
+        traceSocket = Tracer::listenSocket(socket_path);
+        if (traceSocket < 0) cerr << "Couldn't listen on " << socket_path << ": " << strerror(errno) << endl;
+        else {
+            loop.add(traceSocket, EPOLLIN, [&](uint32_t) {
+                tracer->collect();
+                tracer->serve(traceSocket);
+            });
         }
     }
     
-    // Display final grids.
-    cout << "\nFinal Your Grid:" << endl;
-    printPlayerGrid(myMap);
-    cout << "\nFinal Opponent Grid:" << endl;
-    printOpponentGrid(oppMap);
-    cout << "\nGame Over." << endl;
+    if (!client.start()) {
+        cerr << "Couldn't listen on " << server_ip << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    loop.run();
+    
+    if (client.finished()) client.printFinal();
+    
+    if (tracer) {
+        if (keypad.kp) keypad.kp->stop();    // Its last scans are collected too
+        tracer->collect();
+        if (tracer->writeFile(trace_path)) cout << "Turn latency trace written to " << trace_path << endl;
+        else cerr << "Couldn't write " << trace_path << endl;
+        close(collectTimer);
+        if (traceSocket >= 0) {
+            close(traceSocket);
+            unlinkSocketFile(socket_path);
+        }
+    }
     
-    close(sock);
-    kp.stop();
+    close(sigfd);
+    if (keypad.kp) keypad.kp->stop();
     return 0;
 }
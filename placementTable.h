@@ -0,0 +1,159 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Precomputed ship placement masks for fleet generation
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef PLACEMENTTABLE_H
+#define PLACEMENTTABLE_H
+
+#include <vector>
+#include "board.h"
+
+using namespace std;
+
+// One legal position of a ship: the cells it covers and the cells it blocks
+// (itself plus its no-touch halo).
+template <int Size>
+struct BasicPlacement {
+    BasicBitPlane<Size * Size> ship;
+    BasicBitPlane<Size * Size> halo;
+    unsigned char row;
+    unsigned char col;
+    bool isHorizontal;
+};
+
+// Every legal placement of every ship length on a Size x Size grid, built
+// once per grid size.
+// For each placement it also stores, per ship length, the set of placements
+// that it rules out, so a generator can keep "still fits" sets up to date
+// with a few word operations instead of re-testing every placement.
+template <int Size>
+class BasicPlacementTable {
+    public:
+        using Placement = BasicPlacement<Size>;
+
+        // Words needed for one bit per placement of a single ship length
+        static constexpr int words = (2 * Size * Size + 63) / 64;
+
+    private:
+        vector<Placement> byLength[Size + 1];
+        // conflicts[len][(i * (Size + 1) + other_len) * words + w]
+        vector<uint64_t> conflicts[Size + 1];
+        // Per cell, the placements of len that cover it and the placements
+        // of len that only touch it: cover[len][cell * words + w]
+        vector<uint64_t> cover[Size + 1];
+        vector<uint64_t> touch[Size + 1];
+
+        BasicPlacementTable() {
+            for (int len = 1; len <= Size; len++) {
+                for (int horizontal = 1; horizontal >= 0; horizontal--) {
+                    // A length 1 ship looks the same both ways
+                    if (len == 1 && !horizontal) continue;
+                    int max_row = horizontal ? Size - 1 : Size - len;
+                    int max_col = horizontal ? Size - len : Size - 1;
+                    for (int r = 0; r <= max_row; r++) {
+                        for (int c = 0; c <= max_col; c++) {
+                            Placement p;
+                            p.ship = shipMask<Size>(r, c, len, horizontal);
+                            p.halo = haloMask<Size>(r, c, len, horizontal);
+                            p.row = r;
+                            p.col = c;
+                            p.isHorizontal = horizontal;
+                            byLength[len].push_back(p);
+                        }
+                    }
+                }
+            }
+
+            for (int len = 1; len <= Size; len++) {
+                conflicts[len].assign(byLength[len].size() * (Size + 1) * words, 0);
+                for (size_t i = 0; i < byLength[len].size(); i++) {
+                    const BasicBitPlane<Size * Size> &halo = byLength[len][i].halo;
+                    for (int other = 1; other <= Size; other++) {
+                        uint64_t *bits = &conflicts[len][(i * (Size + 1) + other) * words];
+                        for (size_t j = 0; j < byLength[other].size(); j++) {
+                            if (byLength[other][j].ship.intersects(halo)) {
+                                bits[j >> 6] |= uint64_t(1) << (j & 63);
+                            }
+                        }
+                    }
+                }
+            }
+
+            for (int len = 1; len <= Size; len++) {
+                cover[len].assign(Size * Size * words, 0);
+                touch[len].assign(Size * Size * words, 0);
+                for (size_t i = 0; i < byLength[len].size(); i++) {
+                    const Placement &p = byLength[len][i];
+                    for (int cell = 0; cell < Size * Size; cell++) {
+                        uint64_t bit = uint64_t(1) << (i & 63);
+                        if (p.ship.test(cell))      cover[len][cell * words + (i >> 6)] |= bit;
+                        else if (p.halo.test(cell)) touch[len][cell * words + (i >> 6)] |= bit;
+                    }
+                }
+            }
+        }
+
+    public:
+        static const BasicPlacementTable &get() {
+            static const BasicPlacementTable table;
+            return table;
+        }
+
+        const vector<Placement> &placements(int ship_size) const {
+            return byLength[ship_size];
+        }
+
+        // Set one bit per placement of ship_size in out (words entries).
+        void fillAll(int ship_size, uint64_t *out) const {
+            size_t total = byLength[ship_size].size();
+            for (size_t w = 0; w < words; w++) {
+                if (total >= (w + 1) * 64)  out[w] = ~uint64_t(0);
+                else if (total > w * 64)    out[w] = (uint64_t(1) << (total - w * 64)) - 1;
+                else                        out[w] = 0;
+            }
+        }
+
+        // Clear from avail (a set of placements of other_size) every placement
+        // that touches placement idx of ship_size.
+        void removeConflicts(int ship_size, int idx, int other_size, uint64_t *avail) const {
+            const uint64_t *bits = &conflicts[ship_size][(size_t(idx) * (Size + 1) + other_size) * words];
+            for (int w = 0; w < words; w++) {
+                avail[w] &= ~bits[w];
+            }
+        }
+
+        // Placements of ship_size that cover cell (words entries).
+        const uint64_t *covering(int ship_size, int cell) const {
+            return &cover[ship_size][size_t(cell) * words];
+        }
+
+        // Placements of ship_size with cell in their halo but not their ship.
+        // A hit there means the placement would touch another ship.
+        const uint64_t *touching(int ship_size, int cell) const {
+            return &touch[ship_size][size_t(cell) * words];
+        }
+
+        // Number of placements left in a placement set.
+        static int count(const uint64_t *bits) {
+            int n = 0;
+            for (int w = 0; w < words; w++) n += popcount(bits[w]);
+            return n;
+        }
+
+        // Index of the k-th (from zero) placement left in a placement set.
+        static int nth(const uint64_t *bits, int k) {
+            int word = 0;
+            while (popcount(bits[word]) <= k) {
+                k -= popcount(bits[word]);
+                word++;
+            }
+            uint64_t b = bits[word];
+            for (; k > 0; k--) b &= b - 1;    // Drop the lowest k set bits
+            return word * 64 + countr_zero(b);
+        }
+};
+
+using Placement = BasicPlacement<GRID_SIZE>;
+using PlacementTable = BasicPlacementTable<GRID_SIZE>;
+
+#endif // PLACEMENTTABLE_H
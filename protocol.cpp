@@ -0,0 +1,143 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Framed reader and parser for the READY/START/PLAY protocol
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#include <charconv>
+#include "protocol.h"
+
+using namespace std;
+
+// Helper to parse a comma-delimited message.
+string getFromBuffer(string& s_buff, string del) {
+    string ret_str;
+    size_t pos = s_buff.find(del);
+    if (pos != string::npos) {
+        ret_str = s_buff.substr(0, pos);
+        s_buff.erase(0, pos + del.length());
+    } else {
+        ret_str = s_buff;
+        s_buff = "";
+    }
+    return ret_str;
+}
+
+// Split off the text up to the next comma, like getFromBuffer but on a view.
+static string_view nextField(string_view &rest) {
+    size_t pos = rest.find(',');
+    string_view field = rest.substr(0, pos);
+    rest = (pos == string_view::npos) ? string_view() : rest.substr(pos + 1);
+    return field;
+}
+
+// Parse a whole field as a non-negative integer.
+static bool parseInt(string_view field, int &value) {
+    if (field.empty()) return false;
+    auto res = from_chars(field.data(), field.data() + field.size(), value);
+    return res.ec == errc() && res.ptr == field.data() + field.size() && value >= 0;
+}
+
+bool parseMessage(string_view frame, Message &msg) {
+    msg = Message();
+    string_view rest = frame;
+    string_view command = nextField(rest);
+
+    if (command == "PLAY") {
+        string_view second = nextField(rest);
+        if (second == "RESULT") {
+            string_view result = nextField(rest);
+            if (result == "HIT")       msg.result = RESULT_HIT;
+            else if (result == "MISS") msg.result = RESULT_MISS;
+            else if (result == "WIN")  msg.result = RESULT_WIN;
+            else if (result == "SUNK") {
+                if (!parseInt(nextField(rest), msg.sunkSize)) return false;
+                msg.result = RESULT_SUNK;
+            }
+            else return false;
+            msg.type = MSG_RESULT;
+            return true;
+        }
+        if (!parseInt(second, msg.x) || !parseInt(nextField(rest), msg.y)) return false;
+        msg.type = MSG_PLAY;
+        return true;
+    }
+
+    if (command == "START") {
+        if (!parseInt(nextField(rest), msg.position)) return false;
+        msg.name = nextField(rest);
+        msg.gameId = nextField(rest);
+        msg.caps = nextField(rest);
+        msg.type = MSG_START;
+        return true;
+    }
+
+    if (command == "RESUME") {
+        if (!parseInt(nextField(rest), msg.answered) || !parseInt(nextField(rest), msg.received)) return false;
+        msg.type = MSG_RESUME;
+        return true;
+    }
+
+    if (command == "READY") {
+        msg.name = nextField(rest);
+        msg.gameId = nextField(rest);
+        msg.caps = nextField(rest);
+        msg.type = MSG_READY;
+        return true;
+    }
+
+    return false;
+}
+
+bool parseRecord(string_view record, Message &msg) {
+    msg = Message();
+    if (record.size() != BIN_RECORD_SIZE) return false;
+    unsigned char tag = record[0], a = record[1], b = record[2];
+    if (tag == BIN_TAG_PLAY) {
+        msg.x = a;
+        msg.y = b;
+        msg.type = MSG_PLAY;
+        return true;
+    }
+    if (tag == BIN_TAG_RESULT && a >= RESULT_HIT && a <= RESULT_SUNK) {
+        msg.result = ShotResult(a);
+        msg.sunkSize = b;
+        msg.type = MSG_RESULT;
+        return true;
+    }
+    if (tag == BIN_TAG_RESUME) {
+        msg.answered = a;
+        msg.received = b;
+        msg.type = MSG_RESUME;
+        return true;
+    }
+    return false;
+}
+
+bool hasCapability(string_view caps, string_view name) {
+    while (!caps.empty()) {
+        size_t pos = caps.find('+');
+        if (caps.substr(0, pos) == name) return true;
+        if (pos == string_view::npos) break;
+        caps.remove_prefix(pos + 1);
+    }
+    return false;
+}
+
+int capabilityValue(string_view caps, string_view name) {
+    while (!caps.empty()) {
+        size_t pos = caps.find('+');
+        string_view cap = caps.substr(0, pos);
+        int value;
+        if (cap.size() > name.size() && cap.substr(0, name.size()) == name && cap[name.size()] == '=' &&
+            parseInt(cap.substr(name.size() + 1), value)) {
+            return value;
+        }
+        if (pos == string_view::npos) break;
+        caps.remove_prefix(pos + 1);
+    }
+    return -1;
+}
+
+bool useBinaryRecords(string_view caps, string_view otherCaps) {
+    return hasCapability(caps, CAP_BIN) && hasCapability(otherCaps, CAP_BIN) &&
+           capabilityValue(caps, CAP_GRID) <= BIN_MAX_GRID && capabilityValue(otherCaps, CAP_GRID) <= BIN_MAX_GRID;
+}
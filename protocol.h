@@ -0,0 +1,244 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Framed reader and parser for the READY/START/PLAY protocol
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+// Size of the persistent receive buffer, also the longest frame accepted
+#define FRAME_BUFFER_SIZE 4096
+
+using namespace std;
+
+// Optional features a client supports, announced as a '+' separated list
+// in the last field of READY. The server hands each player the opponent's
+// list in START, and a feature is only used if the receiver announced it.
+#define CAP_SUNK "SUNK"    // Understands PLAY,RESULT,SUNK,<size>
+#define CAP_BIN "BIN"      // Binary records after START, see below
+#define CAP_RESUME "RESUME"  // Resuming a journaled game, sends RESUME after START
+#define CAP_GRID "GRID"    // GRID=<size>: large event board, see sparseBoard.h
+
+// Coordinates are decimal numbers of any length in text messages. A binary
+// record has one byte per coordinate (0-255), so a game on a grid larger
+// than BIN_MAX_GRID cells a side stays on text messages. The compile-time
+// configurations (gameConfig.h) are held to the same limit.
+#define BIN_MAX_GRID 256
+
+// Once both players announced CAP_BIN, every message after START is one
+// fixed size record instead of a text line: a tag byte with the high bit
+// set (so never a text character) followed by two value bytes.
+#define BIN_RECORD_SIZE 3
+#define BIN_TAG_PLAY 0x81      // x, y
+#define BIN_TAG_RESULT 0x82    // ShotResult value, sunk ship size
+#define BIN_TAG_RESUME 0x83    // Shots answered, results received (mod 256)
+
+// Outgoing messages queued while handling one event
+#define SEND_QUEUE_SIZE 256
+
+enum MessageType {
+    MSG_UNKNOWN,
+    MSG_READY,     // READY,<name>,<game id>[,<capabilities>]
+    MSG_START,     // START,<position>,<opponent name>,<game id>[,<opponent capabilities>]
+    MSG_PLAY,      // PLAY,<x>,<y>
+    MSG_RESULT,    // PLAY,RESULT,<HIT|MISS|WIN> or PLAY,RESULT,SUNK,<size>
+    MSG_RESUME     // RESUME,<shots answered>,<results received>
+};
+
+enum ShotResult {
+    RESULT_NONE,
+    RESULT_HIT,
+    RESULT_MISS,
+    RESULT_WIN,
+    RESULT_SUNK    // A hit that sank a ship, with more ships left
+};
+
+// A hit of any kind
+inline bool isHit(ShotResult result) {
+    return result == RESULT_HIT || result == RESULT_SUNK || result == RESULT_WIN;
+}
+
+// One parsed message. The string views point into the frame it was parsed
+// from, so they are only valid until the reader is filled again.
+struct Message {
+    MessageType type = MSG_UNKNOWN;
+    string_view name;        // READY: player name, START: opponent name
+    string_view gameId;      // READY and START
+    string_view caps;        // READY: ours, START: the opponent's (may be empty)
+    int position = 0;        // START: 1 moves first, 2 moves second
+    int x = 0, y = 0;        // PLAY
+    ShotResult result = RESULT_NONE;  // RESULT
+    int sunkSize = 0;        // RESULT_SUNK: size of the ship that went down
+    int answered = 0;        // RESUME: opponent shots the sender replied to,
+    int received = 0;        // and replies it got to its own (both mod 256)
+};
+
+// True if the capability list caps contains name
+bool hasCapability(string_view caps, string_view name);
+
+// Value of a name=<number> capability in caps, or -1 if it isn't there
+int capabilityValue(string_view caps, string_view name);
+
+// True if two players with these capability lists exchange binary records:
+// both announced CAP_BIN and neither announced a GRID over BIN_MAX_GRID
+bool useBinaryRecords(string_view caps, string_view otherCaps);
+
+// Parse one binary record (BIN_RECORD_SIZE bytes). Returns false if it is
+// malformed, msg.type is then MSG_UNKNOWN.
+bool parseRecord(string_view record, Message &msg);
+
+// Helper to parse a comma-delimited message: returns the text before del
+// and erases it (and del) from s_buff. Allocates; kept for older callers.
+string getFromBuffer(string& s_buff, string del);
+
+// Parse one frame (without its "\r\n"). Returns false if it is malformed,
+// msg.type is then MSG_UNKNOWN. Does not allocate.
+bool parseMessage(string_view frame, Message &msg);
+
+// Keeps the bytes read from a stream socket and hands them out as complete
+// "\r\n" terminated frames, however the data was split or coalesced by TCP.
+// N is the buffer size and so the longest frame accepted.
+template <size_t N>
+class BasicFrameReader {
+    private:
+        char buf[N];
+        size_t start = 0;    // First byte not yet returned as a frame
+        size_t end = 0;      // One past the last byte received
+        size_t scanned = 0;  // Bytes from start already searched for '\n'
+        bool overflow = false;
+
+        // Move unread bytes to the front to make room at the end
+        void compact() {
+            if (start == 0) return;
+            memmove(buf, buf + start, end - start);
+            end -= start;
+            start = 0;
+        }
+
+    public:
+        // One recv() into the free space. Returns what recv returned:
+        // bytes read, 0 when the peer closed, -1 on error (see errno).
+        // Returns -1 with errno EMSGSIZE and overflowed() set if a frame
+        // doesn't fit the buffer.
+        ssize_t fill(int fd) {
+            if (end == N) compact();
+            if (end == N) {
+                overflow = true;
+                errno = EMSGSIZE;
+                return -1;
+            }
+            ssize_t n = recv(fd, buf + end, N - end, 0);
+            if (n > 0) end += n;
+            return n;
+        }
+
+        // Append bytes that were read some other way (tests, benchmarks).
+        // Returns false if they don't fit.
+        bool feed(const char *data, size_t len) {
+            if (N - end < len) compact();
+            if (N - end < len) {
+                overflow = true;
+                return false;
+            }
+            memcpy(buf + end, data, len);
+            end += len;
+            return true;
+        }
+
+        // Take the next complete frame without its line ending. The view
+        // stays valid until the next fill() or feed().
+        bool next(string_view &frame) {
+            const char *nl = static_cast<const char *>(memchr(buf + start + scanned, '\n', end - start - scanned));
+            if (!nl) {
+                scanned = end - start;
+                return false;
+            }
+            size_t len = nl - (buf + start);
+            size_t frameLen = (len > 0 && buf[start + len - 1] == '\r') ? len - 1 : len;
+            frame = string_view(buf + start, frameLen);
+            start += len + 1;
+            scanned = 0;
+            if (start == end) start = end = 0;
+            return true;
+        }
+
+        // Take the next len bytes as they are (binary records). The view
+        // stays valid until the next fill() or feed().
+        bool nextRecord(size_t len, string_view &record) {
+            if (end - start < len) return false;
+            record = string_view(buf + start, len);
+            start += len;
+            scanned = 0;
+            if (start == end) start = end = 0;
+            return true;
+        }
+
+        // Take everything received so far, whatever its framing
+        string_view takeAll() {
+            string_view data(buf + start, end - start);
+            start = end = scanned = 0;
+            return data;
+        }
+
+        // Bytes received but not yet part of a complete frame
+        size_t pending() const { return end - start; }
+
+        bool overflowed() const { return overflow; }
+};
+
+using FrameReader = BasicFrameReader<FRAME_BUFFER_SIZE>;
+
+// Take the next message from reader, a binary record or a text line.
+// Returns false if no complete one has arrived; a malformed one comes
+// back as MSG_UNKNOWN.
+template <size_t N>
+bool nextMessage(BasicFrameReader<N> &reader, bool binary, Message &msg) {
+    string_view frame;
+    if (binary) {
+        if (!reader.nextRecord(BIN_RECORD_SIZE, frame)) return false;
+        parseRecord(frame, msg);
+    } else {
+        if (!reader.next(frame)) return false;
+        parseMessage(frame, msg);
+    }
+    return true;
+}
+
+// Messages written while handling one event and sent together by flush(),
+// so a shot result and the shot that follows it go out in one system call
+// and one TCP segment. Messages are written straight into the queue.
+class SendQueue {
+    private:
+        char buf[SEND_QUEUE_SIZE];
+        size_t used = 0;
+
+    public:
+        // Where the next message goes and how much room is left for it
+        char *tail() { return buf + used; }
+        size_t room() const { return SEND_QUEUE_SIZE - used; }
+
+        // A message of len bytes was written at tail()
+        void commit(size_t len) { used += len; }
+
+        bool empty() const { return used == 0; }
+        void clear() { used = 0; }
+
+        // Send everything queued with one send(). Returns false if it
+        // didn't all go; the queue is emptied either way.
+        bool flush(int fd) {
+            if (used == 0) return true;
+            ssize_t n = send(fd, buf, used, MSG_NOSIGNAL);
+            bool ok = n == (ssize_t)used;
+            used = 0;
+            return ok;
+        }
+};
+
+#endif // PROTOCOL_H
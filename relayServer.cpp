@@ -0,0 +1,371 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Multi-core reference server for the READY/START/PLAY protocol
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#include <cerrno>
+#include <functional>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "relayServer.h"
+
+using namespace std;
+
+// Events handled per epoll_wait call
+#define SERVER_EVENTS 64
+// Lines gathered into one sendmsg when relaying
+#define RELAY_BATCH 16
+
+// Per-thread state. Connections are only created, read and deleted by
+// the worker that accepted them.
+struct RelayWorker {
+    int listenFd = -1;
+    int epfd = -1;
+    int wakeFd = -1;                  // Written by stop()
+    unordered_set<RelayConnection *> conns;
+};
+
+static const char CRLF[] = "\r\n";
+
+static size_t shardOf(const string &gameId) {
+    return hash<string>()(gameId) % SERVER_SHARDS;
+}
+
+static size_t shardOf(const RelayGame *game) {
+    return hash<const RelayGame *>()(game) % SERVER_SHARDS;
+}
+
+// START,<position>,<opponent>,<game id>[,<opponent capabilities>]
+static string startLine(int position, const RelayConnection *opponent, const string &gameId) {
+    string line = "START," + to_string(position) + "," + opponent->name + "," + gameId;
+    if (!opponent->caps.empty()) line += "," + opponent->caps;
+    return line + "\r\n";
+}
+
+// Send a whole short message without blocking, false if it didn't all go
+static bool sendAll(int fd, const string &text) {
+    return send(fd, text.data(), text.size(), MSG_NOSIGNAL | MSG_DONTWAIT) == (ssize_t)text.size();
+}
+
+RelayServer::RelayServer(int port, int threads) {
+    listenPort = port;
+    numThreads = threads > 0 ? threads : max(1u, thread::hardware_concurrency());
+}
+
+RelayServer::~RelayServer() {
+    stop();
+}
+
+void RelayServer::start() {
+    for (int i = 0; i < numThreads; i++) {
+        RelayWorker *worker = new RelayWorker();
+        workers.push_back(worker);
+
+        worker->listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (worker->listenFd < 0) throw "Couldn't create listening socket";
+        int one = 1;
+        setsockopt(worker->listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        setsockopt(worker->listenFd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(listenPort);
+        if (bind(worker->listenFd, (sockaddr *)&addr, sizeof(addr)) != 0) throw "Couldn't bind server port";
+        if (listen(worker->listenFd, 1024) != 0) throw "Couldn't listen on server port";
+
+        // With port 0 the first socket picks the port and the rest share it
+        if (listenPort == 0) {
+            socklen_t len = sizeof(addr);
+            getsockname(worker->listenFd, (sockaddr *)&addr, &len);
+            listenPort = ntohs(addr.sin_port);
+        }
+
+        worker->epfd = epoll_create1(EPOLL_CLOEXEC);
+        worker->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (worker->epfd < 0 || worker->wakeFd < 0) throw "Couldn't create worker event loop";
+
+        // data.ptr: nullptr for the listening socket, the worker for the
+        // wake fd, otherwise the connection
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;
+        epoll_ctl(worker->epfd, EPOLL_CTL_ADD, worker->listenFd, &ev);
+        ev.data.ptr = worker;
+        epoll_ctl(worker->epfd, EPOLL_CTL_ADD, worker->wakeFd, &ev);
+    }
+
+    for (RelayWorker *worker : workers) {
+        threads.emplace_back(&RelayServer::workerLoop, this, worker);
+    }
+}
+
+void RelayServer::stop() {
+    for (RelayWorker *worker : workers) {
+        uint64_t one = 1;
+        if (write(worker->wakeFd, &one, sizeof(one)) < 0) {}
+    }
+    for (thread &t : threads) t.join();
+    threads.clear();
+
+    // Every worker has stopped, so nothing else touches the tables now
+    unordered_set<RelayGame *> games;
+    for (RelayWorker *worker : workers) {
+        for (RelayConnection *conn : worker->conns) {
+            RelayGame *game = conn->game.load();
+            if (game) games.insert(game);
+            close(conn->fd);
+            delete conn;
+        }
+        close(worker->listenFd);
+        close(worker->epfd);
+        close(worker->wakeFd);
+        delete worker;
+    }
+    for (RelayGame *game : games) delete game;
+    workers.clear();
+    for (int i = 0; i < SERVER_SHARDS; i++) {
+        waiting[i].byGameId.clear();
+        active[i].games.clear();
+    }
+}
+
+void RelayServer::workerLoop(RelayWorker *worker) {
+    epoll_event events[SERVER_EVENTS];
+    while (true) {
+        int n = epoll_wait(worker->epfd, events, SERVER_EVENTS, -1);
+        if (n < 0 && errno != EINTR) return;
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            if (ptr == nullptr) accept(worker);
+            else if (ptr == worker) return;
+            else onReadable(static_cast<RelayConnection *>(ptr));
+        }
+    }
+}
+
+void RelayServer::accept(RelayWorker *worker) {
+    while (true) {
+        int fd = accept4(worker->listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;    // EAGAIN: no more pending connections
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        RelayConnection *conn = new RelayConnection();
+        conn->fd = fd;
+        conn->owner = worker;
+        worker->conns.insert(conn);
+
+        epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = conn;
+        epoll_ctl(worker->epfd, EPOLL_CTL_ADD, fd, &ev);
+
+        stats.connections++;
+        stats.openConnections++;
+    }
+}
+
+void RelayServer::onReadable(RelayConnection *conn) {
+    ssize_t n = conn->reader.fill(conn->fd);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR) || conn->reader.overflowed()) {
+        disconnect(conn);
+        return;
+    }
+
+    // Lines for the peer are gathered and sent with one sendmsg
+    iovec iov[2 * RELAY_BATCH];
+    int lines = 0;
+    string_view line;
+    while (true) {
+        RelayGame *game = conn->game.load();
+        if (game && game->binary) {
+            // Whole records or not, everything goes to the peer as it is
+            string_view data = conn->reader.takeAll();
+            if (!data.empty()) {
+                iov[0].iov_base = const_cast<char *>(data.data());
+                iov[0].iov_len = data.size();
+                relay(conn, iov, 1, max<int>(1, data.size() / BIN_RECORD_SIZE));
+            }
+            return;
+        }
+        if (!conn->reader.next(line)) break;
+        if (game == nullptr) {
+            if (!onLine(conn, line)) {
+                disconnect(conn);
+                return;
+            }
+            continue;
+        }
+        iov[2 * lines].iov_base = const_cast<char *>(line.data());
+        iov[2 * lines].iov_len = line.size();
+        iov[2 * lines + 1].iov_base = const_cast<char *>(CRLF);
+        iov[2 * lines + 1].iov_len = 2;
+        if (++lines == RELAY_BATCH) {
+            relay(conn, iov, 2 * lines, lines);
+            lines = 0;
+        }
+    }
+    if (lines > 0) relay(conn, iov, 2 * lines, lines);
+}
+
+// A line from a connection that isn't in a game yet.
+// Returns false if the connection should be closed.
+bool RelayServer::onLine(RelayConnection *conn, string_view line) {
+    if (line == "STATS") {
+        return sendAll(conn->fd, statsLine() + "\r\n");
+    }
+    Message msg;
+    if (parseMessage(line, msg) && msg.type == MSG_READY) {
+        handleReady(conn, msg);
+    } else {
+        stats.droppedMessages++;
+    }
+    return true;
+}
+
+void RelayServer::handleReady(RelayConnection *conn, const Message &msg) {
+    if (conn->ready) return;    // Already sent READY
+    conn->ready = true;
+    conn->name = string(msg.name);
+    conn->gameId = string(msg.gameId);
+    conn->caps = string(msg.caps);
+
+    WaitingShard &shard = waiting[shardOf(conn->gameId)];
+    RelayGame *game = nullptr;
+    {
+        lock_guard<mutex> lock(shard.lock);
+        auto it = shard.byGameId.find(conn->gameId);
+        if (it == shard.byGameId.end()) {
+            shard.byGameId[conn->gameId] = conn;
+            conn->waiting = true;
+            stats.waitingPlayers++;
+            return;
+        }
+
+        // Pair with the player who was waiting. The game pointers are set
+        // before the shard is unlocked so a disconnecting player always
+        // finds either its waiting entry or its game.
+        RelayConnection *other = it->second;
+        shard.byGameId.erase(it);
+        other->waiting = false;
+        stats.waitingPlayers--;
+
+        game = new RelayGame();
+        game->player[0] = other;
+        game->player[1] = conn;
+        game->binary = useBinaryRecords(other->caps, conn->caps);
+        other->game.store(game);
+        conn->game.store(game);
+    }
+
+    {
+        GameShard &games = active[shardOf(game)];
+        lock_guard<mutex> lock(games.lock);
+        games.games.insert(game);
+    }
+    stats.pairings++;
+    stats.activeGames++;
+
+    // The player who waited moves first. Each gets the opponent's
+    // capabilities, if the opponent announced any.
+    lock_guard<mutex> lock(game->lock);
+    if (game->closed) return;
+    RelayConnection *first = game->player[0];
+    bool ok = sendAll(first->fd, startLine(1, conn, conn->gameId)) &&
+              sendAll(conn->fd, startLine(2, first, conn->gameId));
+    if (!ok) {
+        game->closed = true;
+        stats.activeGames--;
+        shutdown(first->fd, SHUT_RDWR);
+        shutdown(conn->fd, SHUT_RDWR);
+    }
+}
+
+void RelayServer::relay(RelayConnection *conn, const iovec *iov, int count, int lines) {
+    RelayGame *game = conn->game.load();
+    lock_guard<mutex> lock(game->lock);
+    if (game->closed) {
+        stats.droppedMessages += lines;
+        return;
+    }
+    RelayConnection *peer = (game->player[0] == conn) ? game->player[1] : game->player[0];
+
+    size_t total = 0;
+    for (int i = 0; i < count; i++) total += iov[i].iov_len;
+    msghdr hdr = {};
+    hdr.msg_iov = const_cast<iovec *>(iov);
+    hdr.msg_iovlen = count;
+    if (sendmsg(peer->fd, &hdr, MSG_NOSIGNAL | MSG_DONTWAIT) == (ssize_t)total) {
+        stats.relayedMessages += lines;
+        stats.relayedBytes += total;
+        return;
+    }
+
+    // The peer isn't reading (or is gone): end the game rather than buffer
+    stats.droppedMessages += lines;
+    game->closed = true;
+    stats.activeGames--;
+    shutdown(peer->fd, SHUT_RDWR);
+    shutdown(conn->fd, SHUT_RDWR);
+}
+
+void RelayServer::disconnect(RelayConnection *conn) {
+    RelayWorker *worker = conn->owner;
+    epoll_ctl(worker->epfd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    worker->conns.erase(conn);
+
+    if (conn->ready) {
+        WaitingShard &shard = waiting[shardOf(conn->gameId)];
+        lock_guard<mutex> lock(shard.lock);
+        if (conn->waiting) {
+            shard.byGameId.erase(conn->gameId);
+            conn->waiting = false;
+            stats.waitingPlayers--;
+        }
+    }
+
+    RelayGame *game = conn->game.load();
+    if (game) {
+        {
+            lock_guard<mutex> lock(game->lock);
+            if (!game->closed) {
+                game->closed = true;
+                stats.activeGames--;
+                RelayConnection *peer = (game->player[0] == conn) ? game->player[1] : game->player[0];
+                shutdown(peer->fd, SHUT_RDWR);
+            }
+        }
+        releaseGame(game);
+    }
+
+    close(conn->fd);
+    delete conn;
+    stats.openConnections--;
+}
+
+void RelayServer::releaseGame(RelayGame *game) {
+    if (game->refs.fetch_sub(1) != 1) return;
+    {
+        GameShard &games = active[shardOf(game)];
+        lock_guard<mutex> lock(games.lock);
+        games.games.erase(game);
+    }
+    delete game;
+}
+
+string RelayServer::statsLine() const {
+    return "STATS,connections=" + to_string(stats.connections.load()) +
+           ",open=" + to_string(stats.openConnections.load()) +
+           ",pairings=" + to_string(stats.pairings.load()) +
+           ",relayed=" + to_string(stats.relayedMessages.load()) +
+           ",bytes=" + to_string(stats.relayedBytes.load()) +
+           ",dropped=" + to_string(stats.droppedMessages.load()) +
+           ",waiting=" + to_string(stats.waitingPlayers.load()) +
+           ",games=" + to_string(stats.activeGames.load());
+}
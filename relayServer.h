@@ -0,0 +1,118 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Multi-core reference server for the READY/START/PLAY protocol
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef RELAYSERVER_H
+#define RELAYSERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "protocol.h"
+
+// Receive buffer per connection, also the longest line accepted
+#define SERVER_LINE_SIZE 512
+// Number of shards in the waiting and active game tables
+#define SERVER_SHARDS 64
+
+using namespace std;
+
+struct RelayGame;
+struct RelayWorker;
+
+// One client socket, owned by the worker thread that accepted it.
+struct RelayConnection {
+    int fd;
+    RelayWorker *owner;
+    BasicFrameReader<SERVER_LINE_SIZE> reader;
+    string name;                     // From READY
+    string gameId;                   // From READY
+    string caps;                     // From READY, passed to the opponent in START
+    bool ready = false;              // READY received
+    bool waiting = false;            // In the waiting table
+    atomic<RelayGame *> game{nullptr};
+};
+
+// Two paired connections. The mutex guards use of either socket from the
+// other player's thread; closed is set once either side has gone. In a
+// binary game (both announced CAP_BIN) bytes are relayed as they arrive,
+// without looking for line ends.
+struct RelayGame {
+    mutex lock;
+    RelayConnection *player[2];
+    bool binary = false;
+    bool closed = false;
+    atomic<int> refs{2};
+};
+
+// Counters shared by all workers
+struct RelayStats {
+    atomic<uint64_t> connections{0};      // Accepted in total
+    atomic<uint64_t> openConnections{0};
+    atomic<uint64_t> pairings{0};
+    atomic<uint64_t> relayedMessages{0};
+    atomic<uint64_t> relayedBytes{0};
+    atomic<uint64_t> droppedMessages{0};  // Peer gone or not keeping up
+    atomic<uint64_t> waitingPlayers{0};   // Waiting queue depth
+    atomic<uint64_t> activeGames{0};
+};
+
+// Pairs players that send READY with the same game id and relays every
+// line between the two once they are paired. One worker thread per core,
+// each with its own SO_REUSEPORT listening socket and epoll instance, so
+// the kernel spreads connections across the workers. Relaying goes from the
+// sender's receive buffer straight to the peer's socket with no allocation.
+class RelayServer {
+    private:
+        int listenPort;
+        int numThreads;
+        vector<RelayWorker *> workers;
+        vector<thread> threads;
+
+        struct WaitingShard {
+            mutex lock;
+            unordered_map<string, RelayConnection *> byGameId;
+        };
+        struct GameShard {
+            mutex lock;
+            unordered_set<RelayGame *> games;
+        };
+        WaitingShard waiting[SERVER_SHARDS];
+        GameShard active[SERVER_SHARDS];
+
+        void workerLoop(RelayWorker *worker);
+        void accept(RelayWorker *worker);
+        void onReadable(RelayConnection *conn);
+        bool onLine(RelayConnection *conn, string_view line);
+        void handleReady(RelayConnection *conn, const Message &msg);
+        void relay(RelayConnection *conn, const struct iovec *iov, int count, int lines);
+        void disconnect(RelayConnection *conn);
+        void releaseGame(RelayGame *game);
+        string statsLine() const;
+
+    public:
+        RelayStats stats;
+
+        // Port 0 picks a free port, see port() after start().
+        // threads 0 uses one worker per core.
+        RelayServer(int port = 10000, int threads = 0);
+        ~RelayServer();
+
+        // Open the listening sockets and start the workers. Throws on failure.
+        void start();
+
+        // Stop the workers and close every connection
+        void stop();
+
+        int port() const { return listenPort; }
+
+        // Counters as one line of text
+        string report() const { return statsLine(); }
+};
+
+#endif // RELAYSERVER_H
@@ -0,0 +1,335 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Frame-buffered terminal renderer for the game grids
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include "render.h"
+
+using namespace std;
+
+// What a cell shows. Indexes the symbol tables below.
+enum CellView {
+    VIEW_EMPTY,
+    VIEW_SHIP,
+    VIEW_HIT,
+    VIEW_MISS,
+    VIEW_UNKNOWN
+};
+
+// Two columns per cell: the symbol and a space. Your grid shows ships as a
+// solid square, hits as "X" and misses as "o". The opponent grid shows hits
+// as a solid square, misses as blank and everything else as "?".
+static const string_view PLAYER_SYMBOLS[] = {"  ", "■ ", "X ", "o ", "? "};
+static const string_view OPPONENT_SYMBOLS[] = {"  ", "■ ", "■ ", "  ", "? "};
+
+// Screen row of the first grid row in the pinned layout: title, column
+// numbers and rule come first. The grid rows and a blank line follow, and
+// the prompts scroll below them.
+#define PINNED_GRID_ROW 4
+
+// Screen column (from 1) of column col of a grid drawn from the left edge
+static constexpr int cellColumn(int size, int col) {
+    return rowLabelWidth(size) + 3 + 2 * col;
+}
+
+// Screen column where the opponent grid starts when side by side
+static constexpr int pinnedOppColumn(int size) {
+    return rowLabelWidth(size) + 2 + 2 * size + 5;
+}
+
+template <typename Config>
+static unsigned char playerView(const BasicBoard<Config> &board, int idx) {
+    if (board.hit.test(idx))  return VIEW_HIT;
+    if (board.miss.test(idx)) return VIEW_MISS;
+    if (board.ship.test(idx)) return VIEW_SHIP;
+    return VIEW_EMPTY;
+}
+
+template <typename Config>
+static unsigned char opponentView(const BasicBoard<Config> &board, int idx) {
+    if (board.hit.test(idx))  return VIEW_HIT;
+    if (board.miss.test(idx)) return VIEW_MISS;
+    return VIEW_UNKNOWN;
+}
+
+void FrameBuffer::appendInt(int value) {
+    char digits[12];
+    auto res = to_chars(digits, digits + sizeof(digits), value);
+    append(string_view(digits, res.ptr - digits));
+}
+
+bool FrameBuffer::writeTo(int fd) const {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, buf + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+// Blank space as wide as a row label
+static void appendLabelSpace(FrameBuffer &frame, int size) {
+    frame.append(string_view("    ", rowLabelWidth(size) + 2));
+}
+
+// One line of the header: "   0 1 2 ..." (only the last digit past 9) or
+// the rule under it
+static void appendHeaderLine(FrameBuffer &frame, int size, int line) {
+    appendLabelSpace(frame, size);
+    for (int i = 0; i < size; i++) {
+        if (line == 0) {
+            frame.appendInt(i % 10);
+            frame.append(' ');
+        }
+        else frame.append("--");
+    }
+}
+
+static void appendHeader(FrameBuffer &frame, int size) {
+    appendHeaderLine(frame, size, 0);
+    frame.append('\n');
+    appendHeaderLine(frame, size, 1);
+    frame.append('\n');
+}
+
+template <typename Config>
+static void appendRow(FrameBuffer &frame, const BasicBoard<Config> &board, int row, bool player) {
+    constexpr int size = Config::gridSize;
+    if (rowLabelWidth(size) == 2 && row < 10) frame.append(' ');
+    frame.appendInt(row);
+    frame.append("| ");
+    for (int c = 0; c < size; c++) {
+        int idx = cellIndex<size>(row, c);
+        frame.append(player ? PLAYER_SYMBOLS[playerView(board, idx)] : OPPONENT_SYMBOLS[opponentView(board, idx)]);
+    }
+}
+
+template <typename Config>
+void appendPlayerGrid(FrameBuffer &frame, const BasicBoard<Config> &board) {
+    appendHeader(frame, Config::gridSize);
+    for (int r = 0; r < Config::gridSize; r++) {
+        appendRow(frame, board, r, true);
+        frame.append('\n');
+    }
+}
+
+template <typename Config>
+void appendOpponentGrid(FrameBuffer &frame, const BasicBoard<Config> &board) {
+    appendHeader(frame, Config::gridSize);
+    for (int r = 0; r < Config::gridSize; r++) {
+        appendRow(frame, board, r, false);
+        frame.append('\n');
+    }
+}
+
+// ESC [ row ; col H, both counted from 1
+static void appendMoveTo(FrameBuffer &frame, int row, int col) {
+    frame.append("\x1b[");
+    frame.appendInt(row);
+    frame.append(';');
+    frame.appendInt(col);
+    frame.append('H');
+}
+
+template <typename Config>
+BasicGridRenderer<Config>::~BasicGridRenderer() {
+    if (mode == RENDER_DIFF && drawn) {
+        // Setting the region homes the cursor, so save and restore it
+        static const char reset[] = "\x1b" "7" "\x1b[r" "\x1b" "8";
+        if (write(fd, reset, sizeof(reset) - 1) < 0) {}
+    }
+}
+
+template <typename Config>
+void BasicGridRenderer<Config>::buildFull(const Board &mine, const Board &opp) {
+    frame.append("\nYour Grid:\n");
+    appendPlayerGrid(frame, mine);
+    frame.append("\nOpponent Grid:\n");
+    appendOpponentGrid(frame, opp);
+    frame.append('\n');
+}
+
+template <typename Config>
+void BasicGridRenderer<Config>::buildPinned(const Board &mine, const Board &opp) {
+    constexpr int size = Config::gridSize;
+    constexpr int oppColumn = pinnedOppColumn(size);
+    constexpr int pinnedLines = PINNED_GRID_ROW + size;
+
+    // Clear the screen and draw from the top left
+    frame.append("\x1b[H\x1b[2J");
+    frame.append("Your Grid:");
+    appendMoveTo(frame, 1, oppColumn);
+    frame.append("Opponent Grid:\n");
+    for (int line = 0; line < 2; line++) {
+        for (int side = 0; side < 2; side++) {
+            if (side == 1) appendMoveTo(frame, 2 + line, oppColumn);
+            appendHeaderLine(frame, size, line);
+        }
+        frame.append('\n');
+    }
+    for (int r = 0; r < size; r++) {
+        appendRow(frame, mine, r, true);
+        appendMoveTo(frame, PINNED_GRID_ROW + r, oppColumn);
+        appendRow(frame, opp, r, false);
+        frame.append('\n');
+    }
+
+    // Prompts scroll in the lines below the grids
+    frame.append("\x1b[");
+    frame.appendInt(pinnedLines + 1);
+    frame.append('r');
+    appendMoveTo(frame, pinnedLines + 1, 1);
+
+    for (int idx = 0; idx < Config::cells; idx++) {
+        lastMine[idx] = playerView(mine, idx);
+        lastOpp[idx] = opponentView(opp, idx);
+    }
+}
+
+template <typename Config>
+void BasicGridRenderer<Config>::buildDiff(const Board &mine, const Board &opp) {
+    constexpr int size = Config::gridSize;
+    bool saved = false;
+    for (int idx = 0; idx < Config::cells; idx++) {
+        unsigned char views[2] = {playerView(mine, idx), opponentView(opp, idx)};
+        unsigned char *last[2] = {&lastMine[idx], &lastOpp[idx]};
+        for (int side = 0; side < 2; side++) {
+            if (views[side] == *last[side]) continue;
+            if (!saved) {
+                frame.append("\x1b" "7");    // Save the prompt's cursor position
+                saved = true;
+            }
+            int col = cellColumn(size, idx % size) + (side ? pinnedOppColumn(size) - 1 : 0);
+            appendMoveTo(frame, PINNED_GRID_ROW + idx / size, col);
+            frame.append((side ? OPPONENT_SYMBOLS : PLAYER_SYMBOLS)[views[side]]);
+            *last[side] = views[side];
+        }
+    }
+    if (saved) frame.append("\x1b" "8");
+}
+
+template <typename Config>
+const FrameBuffer &BasicGridRenderer<Config>::build(const Board &mine, const Board &opp) {
+    frame.clear();
+    if (mode == RENDER_FULL) buildFull(mine, opp);
+    else if (!drawn) buildPinned(mine, opp);
+    else buildDiff(mine, opp);
+    drawn = true;
+    return frame;
+}
+
+template <typename Config>
+void BasicGridRenderer<Config>::draw(const Board &mine, const Board &opp) {
+    cout << flush;
+    build(mine, opp).writeTo(fd);
+}
+
+// Print the player's own grid.
+// Ships (cells that are not " " and not hit/miss) are shown as a solid square (■),
+// hits as "X", and misses as "o".
+void printPlayerGrid(const string (&grid)[GRID_SIZE][GRID_SIZE]) {
+    cout << "   ";
+    for (int i = 0; i < GRID_SIZE; i++){
+         cout << i << " ";
+    }
+    cout << "\n   ";
+    for (int i = 0; i < GRID_SIZE; i++){
+         cout << "--";
+    }
+    cout << "\n";
+    for (int r = 0; r < GRID_SIZE; r++) {
+       cout << r << "| ";
+       for (int c = 0; c < GRID_SIZE; c++){
+          string cell = grid[r][c];
+          if(cell == "X") {
+              cout << "X ";
+          } else if(cell == "o") {
+              cout << "o ";
+          } else if(cell != " ") {
+              cout << "\u25A0" << " ";  // White square for ship parts
+          } else {
+              cout << "  ";
+          }
+       }
+       cout << "\n";
+    }
+}
+
+// Print the opponent's grid.
+// Unknown cells are shown as "?", misses as blank, and hits as a white square (□, Unicode U+25A1).
+void printOpponentGrid(const string (&grid)[GRID_SIZE][GRID_SIZE]) {
+    cout << "   ";
+    for (int i = 0; i < GRID_SIZE; i++){
+         cout << i << " ";
+    }
+    cout << "\n   ";
+    for (int i = 0; i < GRID_SIZE; i++){
+         cout << "--";
+    }
+    cout << "\n";
+    for (int r = 0; r < GRID_SIZE; r++) {
+       cout << r << "| ";
+       for (int c = 0; c < GRID_SIZE; c++){
+          string cell = grid[r][c];
+          if(cell == "X") {
+              cout << "\u25A0" << " ";  // White square for hits
+          } else if(cell == "o") {
+              cout << "  "; // Misses are blank
+          } else {
+              cout << "? ";
+          }
+       }
+       cout << "\n";
+    }
+}
+
+// Print the player's own board, same symbols as the string version.
+// The whole grid is built in a frame buffer and written at once.
+template <typename Config>
+void printPlayerGrid(const BasicBoard<Config> &board) {
+    FrameBuffer frame;
+    appendPlayerGrid(frame, board);
+    cout << flush;
+    frame.writeTo(STDOUT_FILENO);
+}
+
+// Print the opponent's board, same symbols as the string version.
+template <typename Config>
+void printOpponentGrid(const BasicBoard<Config> &board) {
+    FrameBuffer frame;
+    appendOpponentGrid(frame, board);
+    cout << flush;
+    frame.writeTo(STDOUT_FILENO);
+}
+
+// Display both grids.
+void displayGrids(const string (&myGrid)[GRID_SIZE][GRID_SIZE], const string (&oppGrid)[GRID_SIZE][GRID_SIZE]) {
+    cout << "\nYour Grid:" << endl;
+    printPlayerGrid(myGrid);
+    cout << "\nOpponent Grid:" << endl;
+    printOpponentGrid(oppGrid);
+    cout << endl;
+}
+
+template <typename Config>
+void displayGrids(const BasicBoard<Config> &myBoard, const BasicBoard<Config> &oppBoard) {
+    BasicGridRenderer<Config> renderer;
+    renderer.draw(myBoard, oppBoard);
+}
+
+// Compile the Board versions for every precompiled configuration
+#define INSTANTIATE_RENDER(Config)                                                                      \
+    template class BasicGridRenderer<Config>;                                                           \
+    template void appendPlayerGrid(FrameBuffer &, const BasicBoard<Config> &);                          \
+    template void appendOpponentGrid(FrameBuffer &, const BasicBoard<Config> &);                        \
+    template void printPlayerGrid(const BasicBoard<Config> &);                                          \
+    template void printOpponentGrid(const BasicBoard<Config> &);                                        \
+    template void displayGrids(const BasicBoard<Config> &, const BasicBoard<Config> &);
+FOR_EACH_GAME_CONFIG(INSTANTIATE_RENDER)
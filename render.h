@@ -0,0 +1,119 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Frame-buffered terminal renderer for the game grids
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include "board.h"
+
+// Bytes reserved for one frame. Both grids take about 1 KB.
+#define FRAME_CAPACITY 8192
+
+using namespace std;
+
+// A preallocated output buffer. A whole frame is built here and then sent
+// with one write() instead of one stream call per cell.
+class FrameBuffer {
+    private:
+        char buf[FRAME_CAPACITY];
+        size_t len = 0;
+
+    public:
+        void clear() { len = 0; }
+
+        // Text that doesn't fit is dropped (a frame is far below the capacity).
+        void append(string_view text) {
+            size_t n = min(text.size(), FRAME_CAPACITY - len);
+            memcpy(buf + len, text.data(), n);
+            len += n;
+        }
+
+        void append(char c) {
+            if (len < FRAME_CAPACITY) buf[len++] = c;
+        }
+
+        void appendInt(int value);
+
+        const char *data() const { return buf; }
+        size_t size() const { return len; }
+
+        // Write the buffer to fd, retrying short writes. False on error.
+        bool writeTo(int fd) const;
+};
+
+// Append the grids in the same format as printPlayerGrid/printOpponentGrid.
+// The Board versions of this file are templates on the game configuration,
+// compiled in render.cpp for each one in FOR_EACH_GAME_CONFIG.
+template <typename Config>
+void appendPlayerGrid(FrameBuffer &frame, const BasicBoard<Config> &board);
+template <typename Config>
+void appendOpponentGrid(FrameBuffer &frame, const BasicBoard<Config> &board);
+
+enum RenderMode {
+    RENDER_FULL,    // Print both grids after every shot, like displayGrids
+    RENDER_DIFF     // Keep the grids at the top of the screen, send only changed cells
+};
+
+// Draws your grid and the opponent grid.
+// In RENDER_DIFF mode the first draw clears the screen, puts both grids
+// side by side at the top and makes the lines below them a scroll region
+// for the prompts. Every later draw compares the boards with the last
+// frame and sends a cursor move plus the symbol for each changed cell,
+// so one shot costs a few dozen bytes instead of a full repaint.
+template <typename Config>
+class BasicGridRenderer {
+    private:
+        using Board = BasicBoard<Config>;
+
+        int fd;
+        RenderMode mode;
+        FrameBuffer frame;
+        unsigned char lastMine[Config::cells];
+        unsigned char lastOpp[Config::cells];
+        bool drawn = false;
+
+        void buildFull(const Board &mine, const Board &opp);
+        void buildPinned(const Board &mine, const Board &opp);
+        void buildDiff(const Board &mine, const Board &opp);
+
+    public:
+        explicit BasicGridRenderer(int outFd = STDOUT_FILENO, RenderMode renderMode = RENDER_FULL)
+            : fd(outFd), mode(renderMode) {}
+
+        // Gives the scroll region back to the whole screen (RENDER_DIFF)
+        ~BasicGridRenderer();
+
+        // Build the next frame and write it. Flushes cout first so earlier
+        // prompts come out before the frame.
+        void draw(const Board &mine, const Board &opp);
+
+        // Build the next frame without writing it (benchmarks)
+        const FrameBuffer &build(const Board &mine, const Board &opp);
+
+        // Forget the last frame, the next draw repaints everything
+        void invalidate() { drawn = false; }
+};
+
+using GridRenderer = BasicGridRenderer<ClassicGame>;
+
+// Print a grid to the terminal. The string versions write cell by cell
+// through cout; the Board versions build a frame and write it at once.
+void printPlayerGrid(const string (&grid)[GRID_SIZE][GRID_SIZE]);
+void printOpponentGrid(const string (&grid)[GRID_SIZE][GRID_SIZE]);
+template <typename Config>
+void printPlayerGrid(const BasicBoard<Config> &board);
+template <typename Config>
+void printOpponentGrid(const BasicBoard<Config> &board);
+
+// Display both grids.
+void displayGrids(const string (&myGrid)[GRID_SIZE][GRID_SIZE], const string (&oppGrid)[GRID_SIZE][GRID_SIZE]);
+template <typename Config>
+void displayGrids(const BasicBoard<Config> &myBoard, const BasicBoard<Config> &oppBoard);
+
+#endif // RENDER_H
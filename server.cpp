@@ -0,0 +1,66 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Reference Battleship server, pairs players and relays their moves
+   Authors: Paolo Saliba and Brayton Alvarez
+
+   Players send "READY,<name>,<game id>\r\n". The first two with the same game
+   id are paired with "START,<position>,<opponent>,<game id>\r\n" (the player
+   who waited gets position 1), and every line after that is relayed to the
+   other player. "STATS\r\n" before READY returns the server counters.
+
+   Compilation:
+     g++ -std=c++20 -O2 -o server server.cpp relayServer.cpp protocol.cpp -lpthread
+
+   Usage:
+     ./server [-p port] [-t threads] [-i seconds]
+       -p: port to listen on (default 10000)
+       -t: worker threads (default one per core)
+       -i: print the counters every this many seconds (default off)
+*/
+#include <csignal>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include "relayServer.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    int port = 10000;
+    int threads = 0;
+    int interval = 0;
+    for (int i = 1; i + 1 < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-p") port = stoi(argv[++i]);
+        else if (arg == "-t") threads = stoi(argv[++i]);
+        else if (arg == "-i") interval = stoi(argv[++i]);
+    }
+
+    // Ctrl+C is collected with sigtimedwait. Block it before the workers
+    // start so it is never delivered to them.
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    RelayServer server(port, threads);
+    try {
+        server.start();
+    } catch (const char *err) {
+        cerr << err << endl;
+        return 1;
+    }
+    cout << "Listening on port " << server.port() << endl;
+
+    while (true) {
+        timespec timeout = {interval > 0 ? interval : 3600, 0};
+        int sig = sigtimedwait(&mask, nullptr, &timeout);
+        if (sig == SIGINT || sig == SIGTERM) break;
+        if (interval > 0) cout << server.report() << endl;
+    }
+
+    server.stop();
+    cout << server.report() << endl;
+    return 0;
+}
@@ -0,0 +1,259 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Parallel self-play simulator for comparing shot strategies
+   Authors: Paolo Saliba and Brayton Alvarez
+
+   Plays whole games between two ShotStrategy players in memory, with the
+   same rules as mygame: each player gets the fleet of the configuration
+   ({5,4,3,3,2,2,2} on 10x10 for "classic", see gameConfig.h), a hit (or a
+   SUNK) gives the shooter another turn, a miss passes the turn, and the game
+   ends when one fleet is sunk. Games are split into batches that run on
+   a work-stealing pool, one set of counters per worker. Every batch is
+   seeded from its own index and "density" scores the whole board for
+   every shot (no time budget), so with "-f masks" the totals are the same
+   whatever the number of threads.
+
+   Compilation:
+     g++ -std=c++20 -O2 -o simulate simulate.cpp workPool.cpp -lpthread
+
+   Usage:
+     ./simulate [-c config] [-n games] [-1 strategy] [-2 strategy] [-f autogen|masks] [-j threads] [-b batch] [-s seed] [-H] [-S]
+       -c: grid and fleet: small, classic or large (default classic)
+       -n: games to play (default 1000000)
+       -1, -2: strategy of each player: random, sweep or density (default density and random)
+       -f: fleet layouts from autogenFleet (default) or from the placement masks generator
+       -j: worker threads (default one per core)
+       -b: games per batch (default 1000)
+       -s: seed (default random)
+       -H: answer HIT instead of SUNK, so the shooter isn't told a ship went down
+       -S: run again with 1, 2, 4, ... threads and report the scaling efficiency
+*/
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "board.h"
+#include "fleetGenerator.h"
+#include "gameConfig.h"
+#include "gameRules.h"
+#include "strategy.h"
+#include "workPool.h"
+
+using namespace std;
+
+struct SimConfig {
+    string strategy[2] = {"density", "random"};
+    bool autogen = true;
+    bool sunkNotices = true;     // Tell the shooter when a ship goes down
+    uint64_t games = 1000000;
+    uint64_t batch = 1000;
+    uint64_t seed = 0;
+};
+
+// Counters for one worker, or the merged totals. Every cell shot once is
+// the longest a game can take for one player.
+template <typename Config>
+struct SimStats {
+    static constexpr int MAX_SHOTS = Config::cells;
+
+    uint64_t games = 0;
+    uint64_t wins[2] = {};
+    uint64_t shots = 0;
+    uint64_t shotsToWin[2][MAX_SHOTS + 1] = {};  // Shots the winner fired
+
+    void merge(const SimStats &other) {
+        games += other.games;
+        shots += other.shots;
+        for (int p = 0; p < 2; p++) {
+            wins[p] += other.wins[p];
+            for (int i = 0; i <= MAX_SHOTS; i++) shotsToWin[p][i] += other.shotsToWin[p][i];
+        }
+    }
+};
+
+// One full game. Returns the winner (0 or 1).
+template <typename Config>
+static int playGame(BasicShotStrategy<Config> *players[2], BasicBoard<Config> boards[2], int first, bool sunkNotices,
+                    int shotsFired[2]) {
+    BasicBoard<Config> views[2];
+    players[0]->reset();
+    players[1]->reset();
+    shotsFired[0] = shotsFired[1] = 0;
+
+    int turn = first;
+    while (true) {
+        int x, y;
+        players[turn]->nextShot(views[turn], x, y);
+        int sunkSize = 0;
+        ShotResult result = resolveShot(boards[1 - turn], x, y, &sunkSize);
+        if (result == RESULT_SUNK && !sunkNotices) result = RESULT_HIT;
+        recordResult(views[turn], x, y, result);
+        players[turn]->onResult(x, y, result);
+        if (result == RESULT_SUNK) players[turn]->onSunk(x, y, sunkSize);
+        shotsFired[turn]++;
+        if (result == RESULT_WIN) return turn;
+        // A strategy that keeps missing can't run forever
+        if (shotsFired[turn] > Config::cells) return 1 - turn;
+        if (result == RESULT_MISS) turn = 1 - turn;
+    }
+}
+
+// Games [first, first + count) of the run, seeded from the batch index
+template <typename Config>
+static void playBatch(const SimConfig &config, uint64_t batchIndex, uint64_t first, uint64_t count,
+                      SimStats<Config> &stats) {
+    constexpr int MAX_SHOTS = SimStats<Config>::MAX_SHOTS;
+    uint64_t batchSeed = config.seed ^ (batchIndex * 0x9E3779B97F4A7C15ULL);
+    FleetGenerator generator(batchSeed);
+    unique_ptr<BasicShotStrategy<Config>> owned[2];
+    BasicShotStrategy<Config> *players[2];
+    for (int p = 0; p < 2; p++) {
+        // No time budget: a shot cut short by a busy core would change the totals
+        owned[p] = makeStrategy<Config>(config.strategy[p], batchSeed + 1 + p, Config::fleet, TARGETING_UNLIMITED);
+        players[p] = owned[p].get();
+    }
+
+    BasicBoard<Config> boards[2];
+    for (uint64_t g = first; g < first + count; g++) {
+        for (int p = 0; p < 2; p++) {
+            boards[p].reset();
+            if (config.autogen) autogenFleet(boards[p]);
+            else generator.generate(boards[p]);
+        }
+        // Players take turns going first
+        int shotsFired[2];
+        int winner = playGame(players, boards, g & 1, config.sunkNotices, shotsFired);
+        stats.games++;
+        stats.wins[winner]++;
+        stats.shots += shotsFired[0] + shotsFired[1];
+        stats.shotsToWin[winner][min(shotsFired[winner], MAX_SHOTS)]++;
+    }
+}
+
+// Play config.games on a pool of threads, return the totals and the time
+template <typename Config>
+static SimStats<Config> run(const SimConfig &config, int threads, double &seconds, uint64_t &steals) {
+    WorkStealingPool pool(threads);
+    vector<SimStats<Config>> perWorker(pool.size());
+
+    auto start = chrono::steady_clock::now();
+    uint64_t batches = (config.games + config.batch - 1) / config.batch;
+    for (uint64_t b = 0; b < batches; b++) {
+        uint64_t first = b * config.batch;
+        uint64_t count = min(config.batch, config.games - first);
+        pool.submit([&config, &perWorker, b, first, count](int worker) {
+            playBatch(config, b, first, count, perWorker[worker]);
+        });
+    }
+    pool.wait();
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    steals = pool.steals();
+
+    SimStats<Config> total;
+    for (const SimStats<Config> &s : perWorker) total.merge(s);
+    return total;
+}
+
+// Value below which the fraction p of the winning games fall
+template <int MAX_SHOTS>
+static int percentile(const uint64_t (&hist)[MAX_SHOTS + 1], uint64_t total, double p) {
+    uint64_t rank = uint64_t(p * total), seen = 0;
+    for (int i = 0; i <= MAX_SHOTS; i++) {
+        seen += hist[i];
+        if (seen > rank) return i;
+    }
+    return MAX_SHOTS;
+}
+
+template <int MAX_SHOTS>
+static void printDistribution(const string &name, const uint64_t (&hist)[MAX_SHOTS + 1], uint64_t wins, uint64_t games) {
+    if (wins == 0) {
+        printf("%-8s won 0 games\n", name.c_str());
+        return;
+    }
+    uint64_t sum = 0;
+    int lo = -1, hi = 0;
+    for (int i = 0; i <= MAX_SHOTS; i++) {
+        sum += hist[i] * i;
+        if (hist[i]) {
+            if (lo < 0) lo = i;
+            hi = i;
+        }
+    }
+    printf("%-8s won %llu (%.1f%%), shots to win: mean %.2f  min %d  p10 %d  p50 %d  p90 %d  p99 %d  max %d\n",
+           name.c_str(), (unsigned long long)wins, 100.0 * wins / games, double(sum) / wins, lo,
+           percentile<MAX_SHOTS>(hist, wins, 0.1), percentile<MAX_SHOTS>(hist, wins, 0.5),
+           percentile<MAX_SHOTS>(hist, wins, 0.9), percentile<MAX_SHOTS>(hist, wins, 0.99), hi);
+}
+
+// Run the simulation with one game configuration and print the report
+template <typename Config>
+static void simulate(const SimConfig &config, int threads, bool scaling) {
+    constexpr int MAX_SHOTS = SimStats<Config>::MAX_SHOTS;
+    double seconds;
+    uint64_t steals;
+    SimStats<Config> stats = run<Config>(config, threads, seconds, steals);
+    printf("%llu %s games (%dx%d, %d ships) on %d threads in %.2f s: %.0f games/s, %.1f shots per game, %llu batches stolen\n",
+           (unsigned long long)stats.games, Config::name, Config::gridSize, Config::gridSize, Config::fleetCount,
+           threads, seconds, stats.games / seconds, double(stats.shots) / stats.games, (unsigned long long)steals);
+    for (int p = 0; p < 2; p++) {
+        printDistribution<MAX_SHOTS>(to_string(p + 1) + ":" + config.strategy[p], stats.shotsToWin[p], stats.wins[p],
+                                     stats.games);
+    }
+
+    if (scaling) {
+        printf("\nthreads  games/s     speedup  efficiency\n");
+        // Powers of two, then the full thread count
+        vector<int> counts;
+        for (int t = 1; t < threads; t *= 2) counts.push_back(t);
+        counts.push_back(threads);
+
+        double base = 0;
+        for (int t : counts) {
+            run<Config>(config, t, seconds, steals);
+            double rate = config.games / seconds;
+            if (t == 1) base = rate;
+            printf("%7d  %10.0f  %7.2f  %9.1f%%\n", t, rate, rate / base, 100.0 * rate / (base * t));
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    SimConfig config;
+    config.seed = (uint64_t(random_device{}()) << 32) | random_device{}();
+    int threads = 0;
+    bool scaling = false;
+    string configName = ClassicGame::name;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-S") scaling = true;
+        else if (arg == "-H") config.sunkNotices = false;
+        else if (i + 1 < argc) {
+            if (arg == "-c") configName = argv[++i];
+            else if (arg == "-n") config.games = stoull(argv[++i]);
+            else if (arg == "-1") config.strategy[0] = argv[++i];
+            else if (arg == "-2") config.strategy[1] = argv[++i];
+            else if (arg == "-f") config.autogen = string(argv[++i]) != "masks";
+            else if (arg == "-j") threads = stoi(argv[++i]);
+            else if (arg == "-b") config.batch = max(1ULL, stoull(argv[++i]));
+            else if (arg == "-s") config.seed = stoull(argv[++i]);
+        }
+    }
+    for (int p = 0; p < 2; p++) {
+        if (!makeStrategy(config.strategy[p], 0)) {
+            cerr << "Unknown strategy " << config.strategy[p] << endl;
+            return 1;
+        }
+    }
+    if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+
+    // Each configuration is compiled in, -c picks one
+    if (!withGameConfig(configName, [&](auto game) { simulate<decltype(game)>(config, threads, scaling); })) {
+        cerr << "Unknown configuration " << configName << ", use " GAME_CONFIG_NAMES << endl;
+        return 1;
+    }
+    return 0;
+}
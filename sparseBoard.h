@@ -0,0 +1,182 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Sparse game state for large event boards, indexed by ship intervals
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef SPARSEBOARD_H
+#define SPARSEBOARD_H
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+#include "gameConfig.h"
+
+// Largest grid side a sparse board accepts (coordinates stay within an int)
+#define SPARSE_MAX_SIZE 1000000
+// Most ships a sparse fleet may have (placing them stays well under a second)
+#define SPARSE_MAX_SHIPS 100000
+
+using namespace std;
+
+// One ship of a sparse board
+struct SparseShip {
+    int row, col;              // Top left cell
+    unsigned short size;
+    bool horizontal;
+    unsigned short left;       // Cells not hit yet
+};
+
+// Ships lying along one kind of line (rows for horizontal ships, columns
+// for vertical ones) as [start, end] intervals, sorted by line and then
+// start. Ships never touch, so intervals on one line never overlap and a
+// lookup is one binary search.
+class IntervalIndex {
+    private:
+        struct Interval {
+            int line, start, end;
+            int ship;
+        };
+        vector<Interval> spans;
+
+        // Last interval starting at or before pos on line, or end()
+        vector<Interval>::const_iterator before(int line, int pos) const {
+            auto it = upper_bound(spans.begin(), spans.end(), make_pair(line, pos),
+                                  [](const pair<int, int> &key, const Interval &s) {
+                                      return key.first < s.line || (key.first == s.line && key.second < s.start);
+                                  });
+            if (it == spans.begin()) return spans.end();
+            --it;
+            return it->line == line ? it : spans.end();
+        }
+
+    public:
+        void clear() { spans.clear(); }
+        size_t size() const { return spans.size(); }
+
+        // Ship covering pos on line, or -1
+        int find(int line, int pos) const {
+            auto it = before(line, pos);
+            return (it != spans.end() && it->end >= pos) ? it->ship : -1;
+        }
+
+        // True if any interval on line overlaps [lo, hi]. Only the last one
+        // starting at or before hi can: those before it end before it starts.
+        bool overlaps(int line, int lo, int hi) const {
+            auto it = before(line, hi);
+            return it != spans.end() && it->end >= lo;
+        }
+
+        void insert(int line, int start, int end, int ship) {
+            Interval s = {line, start, end, ship};
+            auto it = upper_bound(spans.begin(), spans.end(), s, [](const Interval &a, const Interval &b) {
+                return a.line < b.line || (a.line == b.line && a.start < b.start);
+            });
+            spans.insert(it, s);
+        }
+};
+
+// Game state for a board too large for bit planes (up to SPARSE_MAX_SIZE
+// cells a side). Ships are found through the interval indexes and shots
+// are kept in hash sets, so memory grows with ships plus shots instead of
+// with the grid, and a shot is resolved in O(log ships). Used on your own
+// board for the fleet and on the opponent view for the shots only.
+class SparseBoard {
+    public:
+        int size = 0;
+        vector<SparseShip> ships;
+        IntervalIndex rows;            // Horizontal ships (and ships of one cell) by row
+        IntervalIndex cols;            // Vertical ships by column
+        unordered_set<uint64_t> hits;  // Cells shot and hit
+        unordered_set<uint64_t> misses;  // Cells shot and missed
+        int64_t cellsLeft = 0;         // Ship cells not hit yet
+
+        explicit SparseBoard(int gridSize = 0) { reset(gridSize); }
+
+        void reset(int gridSize) {
+            size = gridSize;
+            ships.clear();
+            rows.clear();
+            cols.clear();
+            hits.clear();
+            misses.clear();
+            cellsLeft = 0;
+        }
+
+        static uint64_t key(int row, int col) { return (uint64_t(uint32_t(row)) << 32) | uint32_t(col); }
+
+        bool inGrid(int row, int col) const { return row >= 0 && col >= 0 && row < size && col < size; }
+
+        // Index of the ship covering the cell, or -1 for open water.
+        int shipAt(int row, int col) const {
+            int s = rows.find(row, col);
+            return s >= 0 ? s : cols.find(col, row);
+        }
+
+        bool isShip(int row, int col) const { return shipAt(row, col) >= 0; }
+        bool isHit(int row, int col) const  { return hits.count(key(row, col)) != 0; }
+        bool isMiss(int row, int col) const { return misses.count(key(row, col)) != 0; }
+        bool isShot(int row, int col) const { return isHit(row, col) || isMiss(row, col); }
+
+        // True if a ship of ship_size cells fits at (row, col) on the grid
+        // without touching another one, diagonally included.
+        bool fits(int row, int col, int ship_size, bool isHorizontal) const {
+            int hi_row = isHorizontal ? row : row + ship_size - 1;
+            int hi_col = isHorizontal ? col + ship_size - 1 : col;
+            if (!inGrid(row, col) || !inGrid(hi_row, hi_col)) return false;
+            // The ship and its halo: rows row-1..hi_row+1, columns col-1..hi_col+1
+            for (int r = row - 1; r <= hi_row + 1; r++) {
+                if (rows.overlaps(r, col - 1, hi_col + 1)) return false;
+            }
+            for (int c = col - 1; c <= hi_col + 1; c++) {
+                if (cols.overlaps(c, row - 1, hi_row + 1)) return false;
+            }
+            return true;
+        }
+
+        // Add a ship that fits (see fits()). Returns its index.
+        int placeShip(int row, int col, int ship_size, bool isHorizontal) {
+            int s = ships.size();
+            if (ship_size == 1) isHorizontal = true;
+            ships.push_back({row, col, (unsigned short)ship_size, isHorizontal, (unsigned short)ship_size});
+            if (isHorizontal) rows.insert(row, col, col + ship_size - 1, s);
+            else cols.insert(col, row, row + ship_size - 1, s);
+            cellsLeft += ship_size;
+            return s;
+        }
+
+        // Record a hit on the cell. Returns the ship index, or -1 if the cell
+        // holds no ship (always on the opponent view) or was already hit.
+        int markHit(int row, int col) {
+            if (!hits.insert(key(row, col)).second) return -1;
+            int s = shipAt(row, col);
+            if (s >= 0) {
+                ships[s].left--;
+                cellsLeft--;
+            }
+            return s;
+        }
+
+        void markMiss(int row, int col) { misses.insert(key(row, col)); }
+
+        bool isSunk(int s) const { return ships[s].left == 0; }
+        bool allShipsSunk() const { return cellsLeft == 0; }
+
+        int shipsAfloat() const {
+            int n = 0;
+            for (const SparseShip &ship : ships) n += ship.left > 0;
+            return n;
+        }
+};
+
+// A fleet of count ships for a sparse board, largest ships first. Each of
+// the seven entries of the classic fleet gets an equal share of the count,
+// so 7000 ships are 1000 of size 5, 1000 of size 4, 2000 of size 3 and 3000
+// of size 2. Fewer than seven ships take every few entries: 3 is {5, 3, 2}.
+inline vector<unsigned short> sparseFleet(int count) {
+    constexpr int classicCount = ClassicGame::fleetCount;
+    vector<unsigned short> fleet;
+    for (int i = 0; i < count; i++) fleet.push_back(ClassicGame::fleet[i * classicCount / count]);
+    return fleet;
+}
+
+#endif // SPARSEBOARD_H
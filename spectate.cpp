@@ -0,0 +1,180 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Spectator for a game published by mygame -w
+   Authors: Paolo Saliba and Brayton Alvarez
+
+   mygame -w <name> keeps the boards, the turn and every shot in a shared
+   memory segment (spectator.h). This maps it read-only and looks at it a
+   few times a second: the boards come out of a seqlock, retried if the
+   game was writing them at that moment, and the shots out of a ring. The
+   game never waits on a spectator and makes no system call for one, so
+   any number of them can watch.
+
+   By default the screen is redrawn with both grids (as the player sees
+   them), the counts and the last few shots whenever the game changes. A
+   large event game shows the counts only. With -e each shot is printed as
+   one line instead, for logs and scoreboards.
+
+   It waits for the game to start if the feed isn't there yet, and exits
+   when the game exits.
+
+   Compilation:
+     g++ -std=c++20 -O2 -o spectate spectate.cpp spectator.cpp render.cpp -lrt
+
+   Usage:
+     ./spectate [-i milliseconds] [-e] name
+       -i: time between looks at the feed (default 50)
+       -e: print each shot as a line, no grids
+*/
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "render.h"
+#include "spectator.h"
+
+// Shots listed under the grids
+#define RECENT_SHOTS 8
+
+using namespace std;
+
+static const char *phaseText(int phase) {
+    switch (phase) {
+        case SPECTATE_MY_TURN:    return "shooting";
+        case SPECTATE_THEIR_TURN: return "waiting for the opponent's shot";
+        case SPECTATE_WON:        return "won";
+        case SPECTATE_LOST:       return "lost";
+        default:                  return "waiting for an opponent";
+    }
+}
+
+static const char *resultText(int result) {
+    switch (result) {
+        case RESULT_HIT:  return "hit";
+        case RESULT_MISS: return "miss";
+        case RESULT_SUNK: return "sunk";
+        case RESULT_WIN:  return "sunk, game over";
+        default:          return "?";
+    }
+}
+
+// "game 3  alice -> (4, 7) sunk 3"
+static string shotLine(const SpectateState &state, const SpectateEvent &event) {
+    char line[256];
+    const char *shooter = event.mine ? state.player : state.opponent;
+    int n = snprintf(line, sizeof(line), "game %u  %s -> (%d, %d) %s", event.game, *shooter ? shooter : "opponent",
+                     event.x, event.y, resultText(event.result));
+    if (event.result == RESULT_SUNK && event.sunkSize) snprintf(line + n, sizeof(line) - n, " %d", event.sunkSize);
+    return line;
+}
+
+static void fillPlane(Board::Plane &plane, const uint64_t (&words)[BOARD_WORDS]) {
+    for (int i = 0; i < Board::Plane::words; i++) plane.w[i] = words[i];
+}
+
+// Clear the screen and draw the state and the recent shots
+static void draw(const SpectateState &state, const deque<string> &recent, uint64_t lost) {
+    FrameBuffer frame;
+    frame.append("\x1b[H\x1b[2J");
+    char line[256];
+    snprintf(line, sizeof(line), "%s vs %s, game %u: %s %s\n", state.player, *state.opponent ? state.opponent : "?",
+             state.game, state.player, phaseText(state.phase));
+    frame.append(line);
+    snprintf(line, sizeof(line), "%s: %d shots, %d hits, %d ships sunk. Opponent: %d shots, %d hits, %d ships sunk.\n\n",
+             state.player, state.myShots, state.myHits, state.mySunk, state.theirShots, state.theirHits,
+             state.theirSunk);
+    frame.append(line);
+
+    if (state.gridSize == GRID_SIZE) {
+        Board mine, opp;
+        fillPlane(mine.ship, state.myShip);
+        fillPlane(mine.hit, state.myHit);
+        fillPlane(mine.miss, state.myMiss);
+        fillPlane(opp.hit, state.oppHit);
+        fillPlane(opp.miss, state.oppMiss);
+        frame.append(state.player);
+        frame.append("'s Grid:\n");
+        appendPlayerGrid(frame, mine);
+        frame.append("\nOpponent Grid:\n");
+        appendOpponentGrid(frame, opp);
+        frame.append('\n');
+    } else {
+        snprintf(line, sizeof(line), "%d x %d grid, %d ships a side\n\n", state.gridSize, state.gridSize,
+                 state.fleetCount);
+        frame.append(line);
+    }
+
+    for (const string &shot : recent) {
+        frame.append(shot);
+        frame.append('\n');
+    }
+    if (lost) {
+        snprintf(line, sizeof(line), "(%llu shots went by too fast to show)\n", (unsigned long long)lost);
+        frame.append(line);
+    }
+    frame.writeTo(STDOUT_FILENO);
+}
+
+int main(int argc, char *argv[])
+{
+    int intervalMs = 50;
+    bool eventsOnly = false;
+    string name;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-e") eventsOnly = true;
+        else if (arg == "-i" && i + 1 < argc) intervalMs = max(1, stoi(argv[++i]));
+        else name = arg;
+    }
+    if (name.empty()) {
+        cerr << "Usage: ./spectate [-i milliseconds] [-e] name" << endl;
+        return 1;
+    }
+
+    // The game may not have started yet
+    unique_ptr<SpectatorView> view;
+    bool told = false;
+    while (!view) {
+        try {
+            view = make_unique<SpectatorView>(name);
+        }
+        catch (const char *error) {
+            if (!told) cerr << error << ", waiting for the game..." << endl;
+            told = true;
+            this_thread::sleep_for(chrono::milliseconds(intervalMs));
+        }
+    }
+
+    SpectateState state = {};
+    uint32_t shown = 1;          // Odd, so the first look always draws
+    uint64_t next = 0;
+    uint64_t lost = 0;
+    deque<string> recent;
+    while (true) {
+        // Read the flag first: whatever the game wrote before exiting is then
+        // in this last look
+        bool open = view->open();
+        uint32_t version = view->version();
+        bool changed = version != shown;
+        if (changed && view->read(state)) shown = version;   // Changed again since? Read again next time
+        lost += view->poll(next, [&](const SpectateEvent &event) {
+            string line = shotLine(state, event);
+            if (eventsOnly) {
+                cout << line << endl;
+                return;
+            }
+            recent.push_back(line);
+            if (recent.size() > RECENT_SHOTS) recent.pop_front();
+            changed = true;
+        });
+        if (changed && !eventsOnly) draw(state, recent, lost);
+        if (!open) break;
+        this_thread::sleep_for(chrono::milliseconds(intervalMs));
+    }
+    if (eventsOnly && lost) cerr << lost << " shots went by too fast to show" << endl;
+    cout << "The game has ended." << endl;
+    return 0;
+}
@@ -0,0 +1,167 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Shared-memory feed of a live game for local spectators
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "spectator.h"
+
+using namespace std;
+
+// shm_open wants a name starting with '/'
+static string segmentName(const string &segment) {
+    return segment.empty() || segment[0] != '/' ? "/" + segment : segment;
+}
+
+static void copyName(char (&to)[SPECTATE_NAME_SIZE], string_view from) {
+    size_t n = min(from.size(), size_t(SPECTATE_NAME_SIZE - 1));
+    memcpy(to, from.data(), n);
+    memset(to + n, 0, SPECTATE_NAME_SIZE - n);
+}
+
+template <int Cells>
+static void copyPlane(uint64_t (&to)[BOARD_WORDS], const BasicBitPlane<Cells> &from) {
+    for (int i = 0; i < BOARD_WORDS; i++) to[i] = from.w[i];
+}
+
+SpectatorFeed::SpectatorFeed(const string &segment, string_view player, int gridSize, int fleetCount)
+    : name(segmentName(segment)) {
+    // A new segment rather than the old one truncated: readers still
+    // mapping the old one keep it until they let go
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) throw "Couldn't create spectator feed";
+    if (ftruncate(fd, sizeof(SpectateFeed)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw "Couldn't size spectator feed";
+    }
+    void *m = mmap(nullptr, sizeof(SpectateFeed), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw "Couldn't map spectator feed";
+    }
+
+    // A fresh segment is all zeros: the counters and every slot start at 0
+    feed = static_cast<SpectateFeed *>(m);
+    feed->version = SPECTATE_VERSION;
+    copyName(feed->state.player, player);
+    feed->state.gridSize = gridSize;
+    feed->state.fleetCount = fleetCount;
+    feed->open.store(1, memory_order_relaxed);
+    // The magic last: a reader that sees it sees the rest
+    atomic_thread_fence(memory_order_release);
+    feed->magic = SPECTATE_MAGIC;
+}
+
+SpectatorFeed::~SpectatorFeed() {
+    feed->open.store(0, memory_order_release);
+    munmap(feed, sizeof(SpectateFeed));
+    shm_unlink(name.c_str());
+}
+
+void SpectatorFeed::beginWrite() {
+    feed->seq.store(feed->seq.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+void SpectatorFeed::endWrite() {
+    feed->seq.store(feed->seq.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+void SpectatorFeed::startGame(string_view opponent) {
+    beginWrite();
+    SpectateState &s = feed->state;
+    copyName(s.opponent, opponent);
+    s.game++;
+    s.mySunk = s.theirSunk = 0;
+    endWrite();
+}
+
+void SpectatorFeed::shot(bool mine, int x, int y, ShotResult result, int sunkSize) {
+    uint64_t n = feed->events.load(memory_order_relaxed);
+    SpectateFeed::Slot &slot = feed->ring[n % SPECTATE_EVENTS];
+    slot.seq.store(2 * n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    slot.event = {ns, feed->state.game, x, y, uint8_t(mine), uint8_t(result), uint8_t(sunkSize)};
+    slot.seq.store(2 * n + 2, memory_order_release);
+    feed->events.store(n + 1, memory_order_release);
+
+    if (result != RESULT_SUNK && result != RESULT_WIN) return;
+    beginWrite();
+    if (mine) feed->state.mySunk++;
+    else feed->state.theirSunk++;
+    endWrite();
+}
+
+void SpectatorFeed::publish(SpectatePhase phase, const Board &myMap, const Board &oppMap) {
+    beginWrite();
+    SpectateState &s = feed->state;
+    s.phase = phase;
+    s.myHits = oppMap.hit.count();
+    s.myShots = s.myHits + oppMap.miss.count();
+    s.theirHits = myMap.hit.count();
+    s.theirShots = s.theirHits + myMap.miss.count();
+    copyPlane(s.myShip, myMap.ship);
+    copyPlane(s.myHit, myMap.hit);
+    copyPlane(s.myMiss, myMap.miss);
+    copyPlane(s.oppHit, oppMap.hit);
+    copyPlane(s.oppMiss, oppMap.miss);
+    endWrite();
+}
+
+void SpectatorFeed::publish(SpectatePhase phase, const SparseBoard &mine, const SparseBoard &opp) {
+    beginWrite();
+    SpectateState &s = feed->state;
+    s.phase = phase;
+    s.myHits = opp.hits.size();
+    s.myShots = s.myHits + opp.misses.size();
+    s.theirHits = mine.hits.size();
+    s.theirShots = s.theirHits + mine.misses.size();
+    endWrite();
+}
+
+SpectatorView::SpectatorView(const string &segment) {
+    int fd = shm_open(segmentName(segment).c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) throw "No spectator feed by that name";
+    // The client may still be sizing a segment it just created
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SpectateFeed)) {
+        close(fd);
+        throw "The spectator feed isn't ready yet";
+    }
+    void *m = mmap(nullptr, sizeof(SpectateFeed), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) throw "Couldn't map spectator feed";
+    feed = static_cast<const SpectateFeed *>(m);
+    if (feed->magic != SPECTATE_MAGIC) {
+        munmap(const_cast<SpectateFeed *>(feed), sizeof(SpectateFeed));
+        throw "The spectator feed isn't ready yet";
+    }
+    atomic_thread_fence(memory_order_acquire);
+    if (feed->version != SPECTATE_VERSION) {
+        munmap(const_cast<SpectateFeed *>(feed), sizeof(SpectateFeed));
+        throw "Not a spectator feed of this version";
+    }
+}
+
+SpectatorView::~SpectatorView() {
+    munmap(const_cast<SpectateFeed *>(feed), sizeof(SpectateFeed));
+}
+
+bool SpectatorView::read(SpectateState &state) const {
+    for (int i = 0; i < SPECTATE_READ_TRIES; i++) {
+        uint32_t s = feed->seq.load(memory_order_acquire);
+        if (s & 1) continue;
+        memcpy(&state, &feed->state, sizeof(state));
+        atomic_thread_fence(memory_order_acquire);
+        if (feed->seq.load(memory_order_relaxed) == s) return true;
+    }
+    return false;
+}
@@ -0,0 +1,171 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Shared-memory feed of a live game for local spectators
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "board.h"
+#include "protocol.h"
+#include "sparseBoard.h"
+
+// Shot events kept in the ring, a power of two. A reader that falls this
+// far behind loses the oldest ones.
+#define SPECTATE_EVENTS 256
+// Longest player name kept, with its terminating zero
+#define SPECTATE_NAME_SIZE 32
+// Tries a reader makes at a consistent snapshot before giving up for now
+#define SPECTATE_READ_TRIES 64
+
+#define SPECTATE_MAGIC 0x46505342   // "BSPF"
+#define SPECTATE_VERSION 1
+
+using namespace std;
+
+static_assert(atomic<uint32_t>::is_always_lock_free && atomic<uint64_t>::is_always_lock_free,
+              "the feed is shared between processes, its atomics can't hide a lock");
+
+enum SpectatePhase {
+    SPECTATE_WAITING,       // Connecting, or waiting to be paired
+    SPECTATE_MY_TURN,       // The player is shooting
+    SPECTATE_THEIR_TURN,    // The opponent is shooting
+    SPECTATE_WON,
+    SPECTATE_LOST
+};
+
+// Where the game stands, rewritten as a whole under the seqlock. The
+// planes are only filled on the classic grid; a large event game has just
+// the counts.
+struct SpectateState {
+    char player[SPECTATE_NAME_SIZE];
+    char opponent[SPECTATE_NAME_SIZE];
+    int32_t gridSize;
+    int32_t fleetCount;              // Ships per side
+    int32_t phase;                   // SpectatePhase
+    uint32_t game;                   // Games started by this client, from 1
+    int32_t myShots, myHits;         // Our shots at the opponent
+    int32_t theirShots, theirHits;   // The opponent's shots at us
+    int32_t mySunk, theirSunk;       // Ships sunk by us and by them, since the client started
+    uint64_t myShip[BOARD_WORDS];    // Our fleet
+    uint64_t myHit[BOARD_WORDS];     // The opponent's shots on our grid
+    uint64_t myMiss[BOARD_WORDS];
+    uint64_t oppHit[BOARD_WORDS];    // Our shots on theirs
+    uint64_t oppMiss[BOARD_WORDS];
+};
+
+struct SpectateEvent {
+    uint64_t ns;          // steady_clock time, as traceNow()
+    uint32_t game;        // SpectateState::game it belongs to
+    int32_t x, y;
+    uint8_t mine;         // 1 for our shot, 0 for the opponent's
+    uint8_t result;       // ShotResult
+    uint8_t sunkSize;
+};
+
+// The shared segment. seq is odd while the writer is changing state.
+// Event n goes into ring slot n % SPECTATE_EVENTS, whose seq is 2n + 1
+// while it is written and 2n + 2 once it is complete.
+struct SpectateFeed {
+    uint32_t magic;
+    uint32_t version;
+    atomic<uint32_t> open;           // Cleared when the client exits
+    alignas(64) atomic<uint32_t> seq;
+    SpectateState state;
+    alignas(64) atomic<uint64_t> events;   // Events written so far
+    struct Slot {
+        atomic<uint64_t> seq;
+        SpectateEvent event;
+    } ring[SPECTATE_EVENTS];
+};
+
+// The writing side, in the game client. Publishing is a few dozen stores
+// into the shared map: no system call and no lock, and readers never make
+// the writer wait.
+class SpectatorFeed {
+    private:
+        string name;
+        SpectateFeed *feed = nullptr;
+
+        void beginWrite();
+        void endWrite();
+
+    public:
+        // Create the segment name (under /dev/shm), replacing an old one.
+        // Throws if it can't be created or mapped.
+        SpectatorFeed(const string &segment, string_view player, int gridSize, int fleetCount);
+        ~SpectatorFeed();
+
+        SpectatorFeed(const SpectatorFeed &) = delete;
+        SpectatorFeed &operator=(const SpectatorFeed &) = delete;
+
+        // Paired with opponent for a new game (or a resumed one)
+        void startGame(string_view opponent);
+
+        // A shot and its result, ours (mine) or the opponent's
+        void shot(bool mine, int x, int y, ShotResult result, int sunkSize);
+
+        // Snapshot of the boards and the turn
+        void publish(SpectatePhase phase, const Board &myMap, const Board &oppMap);
+        void publish(SpectatePhase phase, const SparseBoard &mine, const SparseBoard &opp);
+};
+
+// The reading side, in any number of other processes. Nothing it does is
+// seen by the writer.
+class SpectatorView {
+    private:
+        const SpectateFeed *feed = nullptr;
+
+    public:
+        // Map the segment read-only. Throws if there is none.
+        SpectatorView(const string &segment);
+        ~SpectatorView();
+
+        SpectatorView(const SpectatorView &) = delete;
+        SpectatorView &operator=(const SpectatorView &) = delete;
+
+        // False once the client has exited
+        bool open() const { return feed->open.load(memory_order_acquire) != 0; }
+
+        // Version of the state, changes with every write
+        uint32_t version() const { return feed->seq.load(memory_order_acquire); }
+
+        // Copy a consistent snapshot into state. False if the writer was
+        // busy on every try (ask again later).
+        bool read(SpectateState &state) const;
+
+        // Pass events from next on to fn in order and advance next. Returns
+        // how many were lost because the ring wrapped past them.
+        template <typename Fn>
+        uint64_t poll(uint64_t &next, Fn fn) const;
+};
+
+template <typename Fn>
+uint64_t SpectatorView::poll(uint64_t &next, Fn fn) const {
+    uint64_t lost = 0;
+    uint64_t written = feed->events.load(memory_order_acquire);
+    if (written - next > SPECTATE_EVENTS) {
+        lost = written - SPECTATE_EVENTS - next;
+        next = written - SPECTATE_EVENTS;
+    }
+    while (next < written) {
+        const SpectateFeed::Slot &slot = feed->ring[next % SPECTATE_EVENTS];
+        uint64_t s = slot.seq.load(memory_order_acquire);
+        SpectateEvent event = slot.event;
+        atomic_thread_fence(memory_order_acquire);
+        if (s != 2 * next + 2 || slot.seq.load(memory_order_relaxed) != s) {
+            // Overwritten while we looked: the writer lapped us
+            lost++;
+            next++;
+            continue;
+        }
+        fn(event);
+        next++;
+    }
+    return lost;
+}
+
+#endif // SPECTATOR_H
@@ -0,0 +1,170 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Pluggable shot selection for automated players
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "board.h"
+#include "fleetGenerator.h"
+#include "protocol.h"
+#include "sparseBoard.h"
+#include "targeting.h"
+
+using namespace std;
+
+// Chooses shots in place of the keypad. One instance plays one game at a
+// time; reset() is called before every game.
+template <typename Config>
+class BasicShotStrategy {
+    public:
+        using Board = BasicBoard<Config>;
+
+        virtual ~BasicShotStrategy() {}
+
+        virtual void reset() {}
+
+        // Pick a cell of oppMap that has not been shot at yet.
+        virtual void nextShot(const Board &oppMap, int &x, int &y) = 0;
+
+        // Reply to the shot just picked (already recorded on oppMap).
+        virtual void onResult(int /*x*/, int /*y*/, ShotResult /*result*/) {}
+
+        // The shot at (x, y) sank a ship of ship_size (after onResult).
+        // Only called when the opponent sends SUNK.
+        virtual void onSunk(int /*x*/, int /*y*/, int /*ship_size*/) {}
+};
+
+// Uniformly random among the cells not shot at yet.
+template <typename Config>
+class BasicRandomStrategy : public BasicShotStrategy<Config> {
+    private:
+        static constexpr int size = Config::gridSize;
+        using Plane = typename BasicBoard<Config>::Plane;
+        FastRng rng;
+
+    public:
+        explicit BasicRandomStrategy(uint64_t seed) : rng(seed) {}
+
+        void nextShot(const BasicBoard<Config> &oppMap, int &x, int &y) override {
+            Plane open = Plane::full().andNot(oppMap.hit | oppMap.miss);
+
+            // k-th open cell, a word at a time
+            int k = rng.bounded(open.count() - 1);
+            int word = 0;
+            while (popcount(open.w[word]) <= k) {
+                k -= popcount(open.w[word]);
+                word++;
+            }
+            uint64_t bits = open.w[word];
+            for (; k > 0; k--) bits &= bits - 1;
+            int idx = word * 64 + countr_zero(bits);
+            y = idx / size;
+            x = idx % size;
+        }
+};
+
+// Row by row from the top left corner. Deterministic, for reproducible runs.
+template <typename Config>
+class BasicSweepStrategy : public BasicShotStrategy<Config> {
+    private:
+        static constexpr int size = Config::gridSize;
+
+    public:
+        void nextShot(const BasicBoard<Config> &oppMap, int &x, int &y) override {
+            for (int idx = 0; idx < size * size; idx++) {
+                if (!oppMap.isShot(idx / size, idx % size)) {
+                    y = idx / size;
+                    x = idx % size;
+                    return;
+                }
+            }
+            x = y = 0;
+        }
+};
+
+// Highest placement density first, see TargetingEngine.
+template <typename Config>
+class BasicDensityStrategy : public BasicShotStrategy<Config> {
+    private:
+        BasicTargetingEngine<Config> engine;
+
+    public:
+        BasicDensityStrategy(const unsigned short(& fleet)[Config::fleetCount], uint64_t seed,
+                             chrono::microseconds budget = chrono::microseconds(TARGETING_BUDGET_US))
+            : engine(fleet, seed, budget) {}
+
+        void reset() override { engine.reset(); }
+
+        void nextShot(const BasicBoard<Config> &oppMap, int &x, int &y) override { engine.nextShot(oppMap, x, y); }
+
+        void onResult(int x, int y, ShotResult result) override { engine.onResult(x, y, result); }
+
+        void onSunk(int x, int y, int ship_size) override { engine.onSunk(x, y, ship_size); }
+};
+
+// Autoplay on a sparse board, where a density map would be as large as the
+// grid: random shots until one hits, then the neighbours of the hits until
+// the ship sinks.
+class SparseHuntStrategy {
+    private:
+        FastRng rng;
+        vector<pair<int, int>> targets;   // Cells next to hits, (x, y)
+
+    public:
+        explicit SparseHuntStrategy(uint64_t seed) : rng(seed) {}
+
+        void reset() { targets.clear(); }
+
+        void nextShot(const SparseBoard &oppMap, int &x, int &y) {
+            while (!targets.empty()) {
+                auto [tx, ty] = targets.back();
+                targets.pop_back();
+                if (oppMap.inGrid(ty, tx) && !oppMap.isShot(ty, tx)) {
+                    x = tx;
+                    y = ty;
+                    return;
+                }
+            }
+            do {
+                x = rng.bounded(oppMap.size - 1);
+                y = rng.bounded(oppMap.size - 1);
+            } while (oppMap.isShot(y, x));
+        }
+
+        void onResult(int x, int y, ShotResult result) {
+            if (result == RESULT_HIT) {
+                targets.push_back({x - 1, y});
+                targets.push_back({x + 1, y});
+                targets.push_back({x, y - 1});
+                targets.push_back({x, y + 1});
+            }
+            // Ships never touch, so nothing next to a sunk ship is left
+            else if (result == RESULT_SUNK) targets.clear();
+        }
+};
+
+using ShotStrategy = BasicShotStrategy<ClassicGame>;
+using RandomStrategy = BasicRandomStrategy<ClassicGame>;
+using SweepStrategy = BasicSweepStrategy<ClassicGame>;
+using DensityStrategy = BasicDensityStrategy<ClassicGame>;
+
+// Strategy by name ("random", "sweep" or "density"), nullptr if the name
+// is unknown. fleet is the opponent's fleet and budget the time allowed
+// per shot, both used by "density".
+template <typename Config = ClassicGame>
+inline unique_ptr<BasicShotStrategy<Config>> makeStrategy(const string &name, uint64_t seed,
+                                                          const unsigned short(& fleet)[Config::fleetCount] = Config::fleet,
+                                                          chrono::microseconds budget = chrono::microseconds(TARGETING_BUDGET_US)) {
+    if (name == "random")  return make_unique<BasicRandomStrategy<Config>>(seed);
+    if (name == "sweep")   return make_unique<BasicSweepStrategy<Config>>();
+    if (name == "density") return make_unique<BasicDensityStrategy<Config>>(fleet, seed, budget);
+    return nullptr;
+}
+
+#endif // STRATEGY_H
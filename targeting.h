@@ -0,0 +1,261 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Placement-density targeting engine for autoplay
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef TARGETING_H
+#define TARGETING_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include "board.h"
+#include "fleetGenerator.h"
+#include "placementTable.h"
+#include "protocol.h"
+
+// Weight of a placement that covers a known hit against one that doesn't.
+// Large enough that finishing a wounded ship always comes first.
+#define TARGET_WEIGHT 1024
+// Default time allowed for choosing one shot
+#define TARGETING_BUDGET_US 200
+// Budget that never runs out: every row is scored, so the shots depend
+// only on the seed (the simulator plays with it)
+#define TARGETING_UNLIMITED chrono::microseconds::max()
+
+using namespace std;
+
+// Picks the unknown cell covered by the most placements of the ships
+// still afloat that agree with everything seen so far.
+//
+// A placement stays possible while it covers no miss and no cell known to
+// be water, and has no hit in its halo (ships never touch). The engine
+// keeps, per ship length, the set of placements still possible and the
+// number of them covering each cell. A shot result only removes the
+// placements it rules out (found with the precomputed cover/touch masks in
+// PlacementTable) and subtracts them from the counts, instead of counting
+// every placement again.
+template <typename Config>
+class BasicTargetingEngine {
+    private:
+        static constexpr int size = Config::gridSize;
+        using Table = BasicPlacementTable<size>;
+        using Plane = typename BasicBoard<Config>::Plane;
+
+        const Table &table;
+        unsigned short fleetMult[size + 1] = {};     // Ships of each length in the fleet
+        unsigned short mult[size + 1] = {};          // Of those, not known to be sunk
+        unsigned short lengths[Config::fleetCount];  // Distinct lengths
+        int numLengths = 0;
+
+        uint64_t valid[size + 1][Table::words];
+        uint64_t onHit[size + 1][Table::words];      // Valid and covering a hit
+        uint16_t count[size + 1][size * size];
+        uint16_t hitCount[size + 1][size * size];
+        uint16_t startCount[size + 1][size * size];  // count at the start of a game
+        Plane known;                                 // Shot or known water
+        Plane hits;
+
+        FastRng rng;
+        chrono::microseconds budget;
+
+        // Cells of placement idx of ship_size
+        template <typename Fn>
+        void forCells(int ship_size, int idx, Fn fn) const {
+            const typename Table::Placement &p = table.placements(ship_size)[idx];
+            for (int i = 0; i < ship_size; i++) {
+                fn(p.isHorizontal ? cellIndex<size>(p.row, p.col + i) : cellIndex<size>(p.row + i, p.col));
+            }
+        }
+
+        // Drop the placements in remove (all still valid) from the counts
+        void removePlacements(int ship_size, const uint64_t *remove) {
+            for (int w = 0; w < Table::words; w++) {
+                uint64_t bits = remove[w];
+                uint64_t hitBits = bits & onHit[ship_size][w];
+                while (bits) {
+                    int idx = w * 64 + countr_zero(bits);
+                    bool covered = (hitBits >> (idx & 63)) & 1;
+                    forCells(ship_size, idx, [&](int cell) {
+                        count[ship_size][cell]--;
+                        if (covered) hitCount[ship_size][cell]--;
+                    });
+                    bits &= bits - 1;
+                }
+                valid[ship_size][w] &= ~remove[w];
+                onHit[ship_size][w] &= ~remove[w];
+            }
+        }
+
+        // The cell holds no ship
+        void markWater(int cell) {
+            if (known.test(cell)) return;
+            known.set(cell);
+            for (int j = 0; j < numLengths; j++) {
+                int len = lengths[j];
+                uint64_t remove[Table::words];
+                const uint64_t *cov = table.covering(len, cell);
+                for (int w = 0; w < Table::words; w++) remove[w] = valid[len][w] & cov[w];
+                removePlacements(len, remove);
+            }
+        }
+
+        void markHit(int row, int col) {
+            int cell = cellIndex<size>(row, col);
+            known.set(cell);
+            hits.set(cell);
+            for (int j = 0; j < numLengths; j++) {
+                int len = lengths[j];
+
+                // Placements that would touch this ship without containing the cell
+                uint64_t remove[Table::words];
+                const uint64_t *tch = table.touching(len, cell);
+                for (int w = 0; w < Table::words; w++) remove[w] = valid[len][w] & tch[w];
+                removePlacements(len, remove);
+
+                // Placements through the hit now count as targets
+                const uint64_t *cov = table.covering(len, cell);
+                for (int w = 0; w < Table::words; w++) {
+                    uint64_t bits = valid[len][w] & cov[w] & ~onHit[len][w];
+                    onHit[len][w] |= bits;
+                    for (; bits; bits &= bits - 1) {
+                        forCells(len, w * 64 + countr_zero(bits), [&](int c) { hitCount[len][c]++; });
+                    }
+                }
+            }
+
+            // Ships are straight and never touch, so the diagonals are water
+            for (int dr = -1; dr <= 1; dr += 2) {
+                for (int dc = -1; dc <= 1; dc += 2) {
+                    int r = row + dr, c = col + dc;
+                    if (r >= 0 && r < size && c >= 0 && c < size) markWater(cellIndex<size>(r, c));
+                }
+            }
+        }
+
+    public:
+        BasicTargetingEngine(const unsigned short(& fleet)[Config::fleetCount], uint64_t seed,
+                        chrono::microseconds timeBudget = chrono::microseconds(TARGETING_BUDGET_US))
+            : table(Table::get()), rng(seed), budget(timeBudget) {
+            for (int i = 0; i < Config::fleetCount; i++) {
+                if (fleetMult[fleet[i]]++ == 0) lengths[numLengths++] = fleet[i];
+            }
+            for (int j = 0; j < numLengths; j++) {
+                for (int cell = 0; cell < size * size; cell++) {
+                    startCount[lengths[j]][cell] = Table::count(table.covering(lengths[j], cell));
+                }
+            }
+            reset();
+        }
+
+        void setBudget(chrono::microseconds timeBudget) { budget = timeBudget; }
+
+        // New game: every placement is possible again
+        void reset() {
+            known.clear();
+            hits.clear();
+            for (int j = 0; j < numLengths; j++) mult[lengths[j]] = fleetMult[lengths[j]];
+            for (int j = 0; j < numLengths; j++) {
+                int len = lengths[j];
+                table.fillAll(len, valid[len]);
+                for (int w = 0; w < Table::words; w++) onHit[len][w] = 0;
+                memcpy(count[len], startCount[len], sizeof(count[len]));
+                memset(hitCount[len], 0, sizeof(hitCount[len]));
+            }
+        }
+
+        // Placements of ship_size still possible that cover cell, and of
+        // those the ones through a hit (what a shot's score is made of)
+        int placementsCovering(int ship_size, int cell) const { return count[ship_size][cell]; }
+        int targetsCovering(int ship_size, int cell) const { return hitCount[ship_size][cell]; }
+
+        // Highest density cell not shot yet, ties broken at random. Cells
+        // are scored a row at a time; if the time budget runs out the best
+        // cell of the rows scored so far is taken.
+        void nextShot(const BasicBoard<Config> &oppMap, int &x, int &y) {
+            bool timed = budget != TARGETING_UNLIMITED;
+            auto deadline = timed ? chrono::steady_clock::now() + budget : chrono::steady_clock::time_point::max();
+            Plane shot = known | oppMap.hit | oppMap.miss;
+            int best = -1;
+            uint32_t bestScore = 0;
+            int ties = 0;
+
+            for (int row = 0; row < size; row++) {
+                int first = row * size;
+                int last = first + size;
+
+                // One pass per length over plain arrays, so the compiler
+                // vectorizes it
+                uint32_t score[size] = {};
+                for (int j = 0; j < numLengths; j++) {
+                    int len = lengths[j];
+                    uint32_t m = mult[len];
+                    for (int cell = first; cell < last; cell++) {
+                        score[cell - first] += m * (count[len][cell] + TARGET_WEIGHT * uint32_t(hitCount[len][cell]));
+                    }
+                }
+
+                for (int cell = first; cell < last; cell++) {
+                    if (shot.test(cell)) continue;
+                    uint32_t s = score[cell - first];
+                    if (best < 0 || s > bestScore) {
+                        best = cell;
+                        bestScore = s;
+                        ties = 1;
+                    }
+                    else if (s == bestScore && rng.bounded(ties++) == 0) {
+                        best = cell;
+                    }
+                }
+                if (timed && best >= 0 && chrono::steady_clock::now() > deadline) break;
+            }
+            if (best < 0) best = 0;    // Nothing left to shoot
+            y = best / size;
+            x = best % size;
+        }
+
+        // Record the reply to the shot at (x, y)
+        void onResult(int x, int y, ShotResult result) {
+            if (isHit(result)) markHit(y, x);
+            else markWater(cellIndex<size>(y, x));
+        }
+
+        // The shot at (x, y), already passed to onResult, sank a ship of
+        // ship_size. Its cells are the run of hits through (x, y) (other
+        // ships never touch it), so every placement over them goes, its
+        // halo is water and one ship of that length is no longer counted.
+        void onSunk(int x, int y, int ship_size) {
+            bool horizontal = (x > 0 && hits.test(cellIndex<size>(y, x - 1))) ||
+                              (x < size - 1 && hits.test(cellIndex<size>(y, x + 1)));
+            int dr = horizontal ? 0 : 1, dc = horizontal ? 1 : 0;
+            int r0 = y, c0 = x;
+            while (r0 - dr >= 0 && c0 - dc >= 0 && hits.test(cellIndex<size>(r0 - dr, c0 - dc))) {
+                r0 -= dr;
+                c0 -= dc;
+            }
+            int len = 0;
+            while (r0 + len * dr < size && c0 + len * dc < size &&
+                   hits.test(cellIndex<size>(r0 + len * dr, c0 + len * dc))) {
+                len++;
+            }
+
+            for (int i = 0; i < len; i++) {
+                int cell = cellIndex<size>(r0 + i * dr, c0 + i * dc);
+                for (int j = 0; j < numLengths; j++) {
+                    int l = lengths[j];
+                    uint64_t remove[Table::words];
+                    const uint64_t *cov = table.covering(l, cell);
+                    for (int w = 0; w < Table::words; w++) remove[w] = valid[l][w] & cov[w];
+                    removePlacements(l, remove);
+                }
+            }
+            Plane halo = haloMask<size>(r0, c0, len, horizontal).andNot(hits);
+            for (int w = 0; w < Plane::words; w++) {
+                for (uint64_t bits = halo.w[w]; bits; bits &= bits - 1) markWater(w * 64 + countr_zero(bits));
+            }
+            if (ship_size <= size && mult[ship_size] > 0) mult[ship_size]--;
+        }
+};
+
+using TargetingEngine = BasicTargetingEngine<ClassicGame>;
+
+#endif // TARGETING_H
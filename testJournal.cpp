@@ -0,0 +1,259 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Tests what replaying the game journal restores after a crash
+   Authors: Paolo Saliba and Brayton Alvarez
+
+   Compilation:
+     g++ -std=c++20 -o testJournal testJournal.cpp journal.cpp
+
+   Each case writes a journal into a temporary file, damages the file the
+   way a crash or another program could, opens it again and checks what
+   replay() rebuilds.
+*/
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include "check.h"
+#include "board.h"
+#include "fleetGenerator.h"
+#include "gameRules.h"
+#include "journal.h"
+
+using namespace std;
+
+static string path;
+
+// Offset of record i in the file
+static off_t recordOffset(int i) {
+    return JOURNAL_HEADER_SIZE + off_t(i) * sizeof(JournalRecord);
+}
+
+static void writeRecord(int i, const JournalRecord &rec) {
+    int fd = open(path.c_str(), O_WRONLY);
+    CHECK(pwrite(fd, &rec, sizeof(rec), recordOffset(i)) == sizeof(rec));
+    close(fd);
+}
+
+// The start of a game: the game and its ships, START with us first, our
+// shot at (x, y) answered with a hit, our shot at (0, 0) answered with a
+// miss, then the opponent's shot at (0, 0). Returns the number of records.
+static int writeGame(const Board &fleet, int x, int y) {
+    GameJournal journal(path);
+    journal.begin(fleet);
+    journal.start(1);
+    journal.shot(x, y);
+    journal.result(RESULT_HIT, 0);
+    journal.shot(0, 0);
+    journal.result(RESULT_MISS, 0);
+    Board scratch = fleet;
+    journal.incoming(0, 0, resolveShot(scratch, 0, 0));
+    return journal.size();
+}
+
+static bool sameShips(const Board &a, const Board &b) {
+    for (int w = 0; w < BOARD_WORDS; w++) {
+        if (a.ship.w[w] != b.ship.w[w]) return false;
+    }
+    return a.cellsLeft == b.cellsLeft;
+}
+
+static void testRoundTrip(const Board &fleet) {
+    int records = writeGame(fleet, 3, 4);
+    CHECK(records == 1 + FLEET_COUNT + 6);
+
+    GameJournal journal(path);
+    CHECK(journal.size() == records);
+    Board myMap, oppMap;
+    int ownResults = 0;
+    JournalReplay rep = journal.replay(myMap, oppMap, [&](int, int, ShotResult, int) { ownResults++; });
+    CHECK(rep.inGame && rep.started);
+    CHECK(rep.records == records);
+    CHECK(sameShips(myMap, fleet));
+    CHECK(oppMap.isHit(4, 3) && oppMap.isMiss(0, 0));
+    CHECK(rep.resultsReceived == 2 && ownResults == 2 && !rep.shotPending);
+    CHECK(rep.shotsAnswered == 1 && myMap.isShot(0, 0));
+    CHECK(rep.myTurn == (rep.lastReply == RESULT_MISS));
+
+    // A game that ended has nothing to resume
+    journal.end();
+    CHECK(!journal.replay(myMap, oppMap).inGame);
+}
+
+static void testTruncated(const Board &fleet) {
+    writeGame(fleet, 3, 4);
+
+    // Cut off after the game record and two ships: the file is grown back
+    // with zeros, which end the journal
+    CHECK(truncate(path.c_str(), recordOffset(3)) == 0);
+    GameJournal journal(path);
+    CHECK(journal.size() == 3);
+    Board myMap, oppMap;
+    JournalReplay rep = journal.replay(myMap, oppMap);
+    CHECK(rep.inGame && !rep.started);
+    CHECK(rep.records == 3);
+    CHECK(myMap.shipSize[0] == fleet.shipSize[0] && myMap.shipSize[1] == fleet.shipSize[1]);
+    CHECK(myMap.shipSize[2] == 0);
+}
+
+static void testTornRecord(const Board &fleet) {
+    int records = writeGame(fleet, 3, 4);
+
+    // Killed while appending our next shot: the fields are written but
+    // seq isn't, so the record doesn't count
+    JournalRecord torn = {JOURNAL_SHOT, 5, 6, 0, 0};
+    writeRecord(records, torn);
+
+    {
+        GameJournal journal(path);
+        CHECK(journal.size() == records);
+        Board myMap, oppMap;
+        JournalReplay rep = journal.replay(myMap, oppMap);
+        CHECK(rep.inGame && rep.started);
+        CHECK(!rep.shotPending);
+        CHECK(rep.resultsReceived == 2);
+
+        // The next append goes where the torn record was
+        journal.shot(7, 8);
+    }
+    GameJournal journal(path);
+    CHECK(journal.size() == records + 1);
+    Board myMap, oppMap;
+    JournalReplay rep = journal.replay(myMap, oppMap);
+    CHECK(rep.shotPending && rep.shotX == 7 && rep.shotY == 8);
+}
+
+static void testTornBegin(const Board &fleet) {
+    writeGame(fleet, 3, 4);
+
+    // Killed while begin() clears the old game: the first record is
+    // already invalid, the old records after it are still in the file
+    // with their seq. None of them are replayed.
+    JournalRecord cleared = {0, 0, 0, 0, 0};
+    writeRecord(0, cleared);
+
+    GameJournal journal(path);
+    CHECK(journal.size() == 0);
+    Board myMap, oppMap;
+    JournalReplay rep = journal.replay(myMap, oppMap);
+    CHECK(!rep.inGame && rep.records == 0);
+    CHECK(myMap.remaining() == 0 && oppMap.hit.count() == 0);
+}
+
+// Contents of the file at path
+static string fileContents(const string &name) {
+    string data;
+    int fd = open(name.c_str(), O_RDONLY);
+    char buf[4096];
+    ssize_t n;
+    while (fd >= 0 && (n = read(fd, buf, sizeof(buf))) > 0) data.append(buf, n);
+    if (fd >= 0) close(fd);
+    return data;
+}
+
+// True if opening name as a journal throws
+static bool refused(const string &name) {
+    try {
+        GameJournal journal(name);
+    }
+    catch (const char *) {
+        return true;
+    }
+    return false;
+}
+
+static void testWrongMagic(const Board &fleet) {
+    writeGame(fleet, 3, 4);
+
+    // A journal with another header (another program's file, or a typo in
+    // -j) is refused and left exactly as it was
+    int fd = open(path.c_str(), O_WRONLY);
+    CHECK(pwrite(fd, "NOTAJRNL", 8, 0) == 8);
+    close(fd);
+    string before = fileContents(path);
+    CHECK(refused(path));
+    CHECK(fileContents(path) == before);
+
+    // So is a short text file, which is neither grown nor zeroed
+    CHECK(truncate(path.c_str(), 0) == 0);
+    fd = open(path.c_str(), O_WRONLY);
+    string text = "# Battleship\r\nnotes\r\n";
+    CHECK(write(fd, text.data(), text.size()) == (ssize_t)text.size());
+    close(fd);
+    CHECK(refused(path));
+    CHECK(fileContents(path) == text);
+
+    // An empty file becomes a journal
+    CHECK(truncate(path.c_str(), 0) == 0);
+    GameJournal journal(path);
+    CHECK(journal.size() == 0);
+    Board myMap, oppMap;
+    CHECK(!journal.replay(myMap, oppMap).inGame);
+    journal.begin(fleet);
+    CHECK(journal.size() == 1 + FLEET_COUNT);
+}
+
+static void testLocked(const Board &fleet) {
+    // A second game on the same journal, in this or another process, is
+    // refused while the first one has it open
+    {
+        GameJournal journal(path);
+        journal.begin(fleet);
+        CHECK(refused(path));
+        CHECK(journal.size() == 1 + FLEET_COUNT);
+    }
+    CHECK(!refused(path));
+}
+
+static void testFull(const Board &fleet) {
+    int answered = 0;
+    {
+        GameJournal journal(path);
+        journal.begin(fleet);
+        journal.start(0);
+        Board scratch = fleet;
+        while (journal.size() < JOURNAL_RECORDS) {
+            int x = answered % GRID_SIZE, y = (answered / GRID_SIZE) % GRID_SIZE;
+            journal.incoming(x, y, resolveShot(scratch, x, y));
+            answered++;
+        }
+        CHECK(answered == JOURNAL_RECORDS - 2 - FLEET_COUNT);
+
+        // Nothing more fits, not even the end of the game
+        journal.shot(1, 1);
+        journal.end();
+        CHECK(journal.size() == JOURNAL_RECORDS);
+    }
+
+    GameJournal journal(path);
+    CHECK(journal.size() == JOURNAL_RECORDS);
+    Board myMap, oppMap;
+    JournalReplay rep = journal.replay(myMap, oppMap);
+    CHECK(rep.records == JOURNAL_RECORDS);
+    CHECK(rep.inGame && rep.started && !rep.shotPending);
+    CHECK(rep.shotsAnswered == answered);
+    CHECK(myMap.allShipsSunk());
+}
+
+int main() {
+    char name[] = "/tmp/journalXXXXXX";
+    int fd = mkstemp(name);
+    if (!CHECK(fd >= 0)) return checkResult("testJournal");
+    close(fd);
+    path = name;
+
+    FleetGenerator generator(42);
+    Board fleet;
+    generator.generate(fleet);
+
+    testRoundTrip(fleet);
+    testTruncated(fleet);
+    testTornRecord(fleet);
+    testTornBegin(fleet);
+    testWrongMagic(fleet);
+    testLocked(fleet);
+    testFull(fleet);
+
+    unlink(name);
+    return checkResult("testJournal");
+}
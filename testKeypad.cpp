@@ -0,0 +1,242 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Tests the keypad scan, debounce, rollover and ghost masking off the Pi
+   Authors: Paolo Saliba and Brayton Alvarez
+
+   Compilation (no wiringPi needed):
+     g++ -std=c++20 -o testKeypad testKeypad.cpp keypad.cpp gpioMock.cpp gpioMmap.cpp -lpthread
+
+   Scans are fed to the debounce by hand, one at a time, so every step of a
+   press, bounce and release is checked without timing. The last cases run
+   the scanner thread against the mock and the file-backed register map.
+*/
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <poll.h>
+#include <unistd.h>
+#include "check.h"
+#include "keypad.h"
+#include "gpioMock.h"
+#include "gpioMmap.h"
+
+using namespace std;
+
+static int colPins[MAXCOL] = {21, 20, 16};
+static int rowPins[MAXROW] = {19, 13, 6, 5};
+
+// Bit of the key at row r, column c in a scan
+static uint32_t keyBit(int r, int c) {
+    return uint32_t(1) << (r * MAXCOL + c);
+}
+
+// One scan through the mock, run through the debounce
+static void scanOnce(Keypad &kp) {
+    kp.debounce_keys(kp.scan());
+}
+
+// Take the next queued event and check it is key going down or up
+static bool nextEvent(Keypad &kp, char key, bool pressed) {
+    KeyEvent event;
+    if (!kp.poll_event(event)) return false;
+    return event.key == key && event.pressed == pressed;
+}
+
+static bool noEvent(Keypad &kp) {
+    KeyEvent event;
+    return !kp.poll_event(event);
+}
+
+static void testScan() {
+    MockGpio mock;
+    Keypad kp(colPins, rowPins, mock);
+    CHECK(kp.scan() == 0);
+
+    // "5" is row 1, column 1
+    mock.press(rowPins[1], colPins[1]);
+    CHECK(kp.scan() == keyBit(1, 1));
+
+    // Two keys on different rows and columns both read down
+    mock.press(rowPins[3], colPins[2]);
+    CHECK(kp.scan() == (keyBit(1, 1) | keyBit(3, 2)));
+    mock.release(rowPins[1], colPins[1]);
+    mock.release(rowPins[3], colPins[2]);
+    CHECK(kp.scan() == 0);
+}
+
+static void testPressAndRelease() {
+    MockGpio mock;
+    Keypad kp(colPins, rowPins, mock);
+
+    mock.press(rowPins[1], colPins[1]);
+    for (int i = 1; i < KEY_PRESS_SCANS; i++) scanOnce(kp);
+    CHECK(noEvent(kp));
+    scanOnce(kp);
+    CHECK(nextEvent(kp, '5', true));
+    CHECK(noEvent(kp));
+
+    // Held: no more events
+    for (int i = 0; i < 20; i++) scanOnce(kp);
+    CHECK(noEvent(kp));
+
+    mock.release(rowPins[1], colPins[1]);
+    for (int i = 1; i < KEY_RELEASE_SCANS; i++) scanOnce(kp);
+    CHECK(noEvent(kp));
+    scanOnce(kp);
+    CHECK(nextEvent(kp, '5', false));
+    CHECK(noEvent(kp));
+}
+
+static void testBounce() {
+    MockGpio mock;
+    Keypad kp(colPins, rowPins, mock);
+
+    // Contact bounce on the way down: single scans down never count
+    for (int i = 0; i < 5; i++) {
+        mock.press(rowPins[0], colPins[2]);
+        scanOnce(kp);
+        mock.release(rowPins[0], colPins[2]);
+        scanOnce(kp);
+    }
+    CHECK(noEvent(kp));
+
+    // Then it settles: one press
+    mock.press(rowPins[0], colPins[2]);
+    for (int i = 0; i < KEY_PRESS_SCANS + 3; i++) scanOnce(kp);
+    CHECK(nextEvent(kp, '3', true));
+    CHECK(noEvent(kp));
+
+    // Bounce on the way up: a down reading before the release settles
+    // starts the count again
+    mock.release(rowPins[0], colPins[2]);
+    for (int i = 1; i < KEY_RELEASE_SCANS; i++) scanOnce(kp);
+    mock.press(rowPins[0], colPins[2]);
+    scanOnce(kp);
+    mock.release(rowPins[0], colPins[2]);
+    for (int i = 1; i < KEY_RELEASE_SCANS; i++) scanOnce(kp);
+    CHECK(noEvent(kp));
+    scanOnce(kp);
+    CHECK(nextEvent(kp, '3', false));
+    CHECK(noEvent(kp));
+}
+
+static void testRollover() {
+    MockGpio mock;
+    Keypad kp(colPins, rowPins, mock);
+
+    // "1" down, then "9" down before "1" is let go, then "1" up, then "9" up
+    mock.press(rowPins[0], colPins[0]);
+    for (int i = 0; i < KEY_PRESS_SCANS; i++) scanOnce(kp);
+    mock.press(rowPins[2], colPins[2]);
+    for (int i = 0; i < KEY_PRESS_SCANS; i++) scanOnce(kp);
+    mock.release(rowPins[0], colPins[0]);
+    for (int i = 0; i < KEY_RELEASE_SCANS; i++) scanOnce(kp);
+    mock.release(rowPins[2], colPins[2]);
+    for (int i = 0; i < KEY_RELEASE_SCANS; i++) scanOnce(kp);
+
+    CHECK(nextEvent(kp, '1', true));
+    CHECK(nextEvent(kp, '9', true));
+    CHECK(nextEvent(kp, '1', false));
+    CHECK(nextEvent(kp, '9', false));
+    CHECK(noEvent(kp));
+}
+
+static void testGhosts() {
+    // Three corners of a rectangle down make the fourth read down
+    uint32_t three = keyBit(0, 0) | keyBit(0, 1) | keyBit(1, 0);
+    uint32_t four = three | keyBit(1, 1);
+    CHECK(Keypad::ghost_keys(three) == 0);
+    CHECK(Keypad::ghost_keys(four) == four);
+    CHECK(Keypad::ghost_keys(keyBit(0, 0) | keyBit(1, 1) | keyBit(2, 2)) == 0);
+
+    // The mock has no phantom paths, so the scans are fed by hand
+    MockGpio mock;
+    Keypad kp(colPins, rowPins, mock);
+    for (int i = 0; i < KEY_PRESS_SCANS; i++) kp.debounce_keys(three);
+    CHECK(nextEvent(kp, '1', true));
+    CHECK(nextEvent(kp, '2', true));
+    CHECK(nextEvent(kp, '4', true));
+
+    // "5" reads down with the other three: it may be a phantom, so no press,
+    // and the three already down stay down
+    for (int i = 0; i < 10; i++) kp.debounce_keys(four);
+    CHECK(noEvent(kp));
+
+    // "2" is let go: the rectangle is broken and "5" is a real press,
+    // which settles before the release of "2"
+    uint32_t cleared = four & ~keyBit(0, 1);
+    for (int i = 0; i < KEY_RELEASE_SCANS; i++) kp.debounce_keys(cleared);
+    CHECK(nextEvent(kp, '5', true));
+    CHECK(nextEvent(kp, '2', false));
+    CHECK(noEvent(kp));
+}
+
+static void testEdgeTriggeredThread() {
+    MockGpio mock;
+    Keypad kp(colPins, rowPins, mock, true);
+    kp.run();
+
+    // Taken the way the game's event loop takes them: wait for the event
+    // fd, clear it, then drain the queue
+    KeyEvent event;
+    pollfd ready = {kp.event_fd(), POLLIN, 0};
+    mock.press(rowPins[3], colPins[1]);
+    CHECK(poll(&ready, 1, 1000) == 1);
+    kp.clear_event_fd();
+    CHECK(kp.poll_event(event));
+    CHECK(event.key == '0' && event.pressed);
+    auto pressed = event.time;
+
+    // Blocking wait for the release
+    mock.release(rowPins[3], colPins[1]);
+    CHECK(kp.try_get_event(event, chrono::milliseconds(1000)));
+    CHECK(event.key == '0' && !event.pressed);
+    CHECK(event.time >= pressed);
+    CHECK(!kp.try_get_event(event, chrono::milliseconds(20)));
+    kp.stop();
+}
+
+static void testRegisterMapScan() {
+    char path[] = "/tmp/gpioblockXXXXXX";
+    int fd = mkstemp(path);
+    if (!CHECK(fd >= 0)) return;
+    close(fd);
+    {
+        MmapGpio regs(path);
+        Keypad kp(colPins, rowPins, regs);
+
+        // Level register: every row high, nothing down
+        volatile uint32_t *level = regs.registers() + 13;
+        uint32_t rows = 0;
+        for (int r = 0; r < MAXROW; r++) rows |= uint32_t(1) << rowPins[r];
+        *level = rows;
+        CHECK(kp.scan() == 0);
+
+        // The file doesn't follow the driven column, so a low row 2 reads
+        // as every key of row 2 down
+        *level = rows & ~(uint32_t(1) << rowPins[2]);
+        CHECK(kp.scan() == (keyBit(2, 0) | keyBit(2, 1) | keyBit(2, 2)));
+
+        // Every column was left an input, the last one driven low through GPCLR0
+        uint32_t fsel = regs.registers()[2];    // GPFSEL2 holds pins 20-29
+        CHECK(((fsel >> ((colPins[0] - 20) * 3)) & 7) == 0);
+        CHECK(regs.registers()[10] == (uint32_t(1) << colPins[MAXCOL - 1]));
+
+        // Debounced like any other backend
+        for (int i = 0; i < KEY_PRESS_SCANS; i++) kp.debounce_keys(kp.scan());
+        CHECK(nextEvent(kp, '7', true));
+        CHECK(nextEvent(kp, '8', true));
+        CHECK(nextEvent(kp, '9', true));
+    }
+    unlink(path);
+}
+
+int main() {
+    testScan();
+    testPressAndRelease();
+    testBounce();
+    testRollover();
+    testGhosts();
+    testEdgeTriggeredThread();
+    testRegisterMapScan();
+    return checkResult("testKeypad");
+}
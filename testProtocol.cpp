@@ -0,0 +1,216 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Tests the frame reader and the message parser of the protocol
+   Authors: Paolo Saliba and Brayton Alvarez
+
+   Compilation:
+     g++ -std=c++20 -o testProtocol testProtocol.cpp protocol.cpp
+
+   The relay server, the client, the load driver and the analyzer all read
+   their messages through BasicFrameReader and parseMessage, so the cases
+   here cover the ways TCP splits and joins the stream as well as the
+   messages themselves.
+*/
+#include <cerrno>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "check.h"
+#include "protocol.h"
+
+using namespace std;
+
+template <size_t N>
+static bool feedText(BasicFrameReader<N> &reader, string_view text) {
+    return reader.feed(text.data(), text.size());
+}
+
+static void testSplitFrame() {
+    // One message arriving a few bytes at a time
+    FrameReader reader;
+    string_view frame;
+    CHECK(feedText(reader, "PLA"));
+    CHECK(!reader.next(frame));
+    CHECK(feedText(reader, "Y,3,"));
+    CHECK(!reader.next(frame));
+    CHECK(feedText(reader, "7\r"));
+    CHECK(!reader.next(frame));
+    CHECK(reader.pending() == 9);
+    CHECK(feedText(reader, "\n"));
+    CHECK(reader.next(frame) && frame == "PLAY,3,7");
+    CHECK(!reader.next(frame));
+    CHECK(reader.pending() == 0);
+
+    // The same through recv() on a socket, one byte per read
+    int fds[2];
+    if (!CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0)) return;
+    string_view text = "PLAY,RESULT,HIT\r\n";
+    int frames = 0;
+    for (char c : text) {
+        CHECK(write(fds[0], &c, 1) == 1);
+        CHECK(reader.fill(fds[1]) == 1);
+        while (reader.next(frame)) {
+            CHECK(frame == "PLAY,RESULT,HIT");
+            frames++;
+        }
+    }
+    CHECK(frames == 1);
+
+    // A closed peer reads as 0
+    close(fds[0]);
+    CHECK(reader.fill(fds[1]) == 0);
+    close(fds[1]);
+}
+
+static void testSeveralFrames() {
+    // Several messages, the last one incomplete, in one read
+    FrameReader reader;
+    string_view frame;
+    CHECK(feedText(reader, "START,1,bob,42,SUNK\r\nPLAY,0,9\r\nPLAY,RESULT,MISS\r\nPLAY,4"));
+    CHECK(reader.next(frame) && frame == "START,1,bob,42,SUNK");
+    CHECK(reader.next(frame) && frame == "PLAY,0,9");
+    CHECK(reader.next(frame) && frame == "PLAY,RESULT,MISS");
+    CHECK(!reader.next(frame));
+    CHECK(reader.pending() == 6);
+    CHECK(feedText(reader, ",5\r\n"));
+    CHECK(reader.next(frame) && frame == "PLAY,4,5");
+
+    // Binary records mixed with nothing else, two and a half at a time
+    const char records[] = {char(BIN_TAG_PLAY), 2, 3, char(BIN_TAG_RESULT), RESULT_SUNK, 4, char(BIN_TAG_PLAY), 1};
+    CHECK(reader.feed(records, sizeof(records)));
+    Message msg;
+    CHECK(nextMessage(reader, true, msg) && msg.type == MSG_PLAY && msg.x == 2 && msg.y == 3);
+    CHECK(nextMessage(reader, true, msg) && msg.type == MSG_RESULT && msg.result == RESULT_SUNK && msg.sunkSize == 4);
+    CHECK(!nextMessage(reader, true, msg));
+    const char last = 8;
+    CHECK(reader.feed(&last, 1));
+    CHECK(nextMessage(reader, true, msg) && msg.type == MSG_PLAY && msg.x == 1 && msg.y == 8);
+}
+
+static void testLineEndings() {
+    FrameReader reader;
+    string_view frame;
+
+    // CRLF and a bare LF both end a frame, neither is part of it
+    CHECK(feedText(reader, "PLAY,1,2\r\nPLAY,3,4\n"));
+    CHECK(reader.next(frame) && frame == "PLAY,1,2");
+    CHECK(reader.next(frame) && frame == "PLAY,3,4");
+
+    // A CR split from its LF by a read
+    CHECK(feedText(reader, "PLAY,RESULT,WIN\r"));
+    CHECK(!reader.next(frame));
+    CHECK(feedText(reader, "\nPLAY,5,6\r\n"));
+    CHECK(reader.next(frame) && frame == "PLAY,RESULT,WIN");
+    CHECK(reader.next(frame) && frame == "PLAY,5,6");
+
+    // An empty line is an empty frame, which isn't a message
+    CHECK(feedText(reader, "\r\n"));
+    Message msg;
+    CHECK(reader.next(frame) && frame.empty());
+    CHECK(!parseMessage(frame, msg) && msg.type == MSG_UNKNOWN);
+}
+
+static void testOverlongFrame() {
+    // A frame longer than the buffer can't be held: feed() refuses the
+    // bytes that don't fit and the reader reports the overflow
+    BasicFrameReader<64> reader;
+    string_view frame;
+    CHECK(feedText(reader, "READY," + string(50, 'a')));
+    CHECK(!reader.next(frame));
+    CHECK(!reader.overflowed());
+    CHECK(!feedText(reader, string(10, 'a') + ",1\r\n"));
+    CHECK(reader.overflowed());
+
+    // Through recv(): fill() returns -1 once the buffer is full of one frame,
+    // with an errno that a caller waiting for EAGAIN doesn't mistake for
+    // "nothing more to read"
+    BasicFrameReader<64> socketReader;
+    int fds[2];
+    if (!CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0)) return;
+    string text(100, 'x');
+    CHECK(write(fds[0], text.data(), text.size()) == (ssize_t)text.size());
+    CHECK(socketReader.fill(fds[1]) == 64);
+    CHECK(!socketReader.next(frame));
+    errno = EAGAIN;
+    CHECK(socketReader.fill(fds[1]) == -1 && socketReader.overflowed());
+    CHECK(errno == EMSGSIZE);
+    close(fds[0]);
+    close(fds[1]);
+
+    // A frame that fits exactly, once the frames before it are taken
+    BasicFrameReader<16> small;
+    CHECK(feedText(small, "PLAY,1,1\r\nPLAY,"));
+    CHECK(small.next(frame) && frame == "PLAY,1,1");
+    CHECK(feedText(small, "10,11\r\n"));
+    CHECK(small.next(frame) && frame == "PLAY,10,11");
+    CHECK(!small.overflowed());
+}
+
+static void testMessages() {
+    Message msg;
+    CHECK(parseMessage("READY,alice,7,SUNK+BIN+GRID=1000", msg) && msg.type == MSG_READY);
+    CHECK(msg.name == "alice" && msg.gameId == "7" && msg.caps == "SUNK+BIN+GRID=1000");
+    CHECK(hasCapability(msg.caps, CAP_SUNK) && hasCapability(msg.caps, CAP_BIN) && !hasCapability(msg.caps, CAP_RESUME));
+    CHECK(capabilityValue(msg.caps, CAP_GRID) == 1000);
+    CHECK(capabilityValue("SUNK", CAP_GRID) == -1);
+
+    // Binary records only when both offer them and the grid fits a byte
+    CHECK(useBinaryRecords("SUNK+BIN", "BIN"));
+    CHECK(!useBinaryRecords("SUNK+BIN", "SUNK"));
+    CHECK(useBinaryRecords("BIN+GRID=256", "BIN+GRID=256"));
+    CHECK(!useBinaryRecords("BIN+GRID=257", "BIN+GRID=257"));
+
+    CHECK(parseMessage("START,2,bob,7", msg) && msg.type == MSG_START);
+    CHECK(msg.position == 2 && msg.name == "bob" && msg.gameId == "7" && msg.caps.empty());
+
+    CHECK(parseMessage("PLAY,RESULT,SUNK,3", msg) && msg.type == MSG_RESULT);
+    CHECK(msg.result == RESULT_SUNK && msg.sunkSize == 3);
+    CHECK(parseMessage("RESUME,12,11", msg) && msg.type == MSG_RESUME && msg.answered == 12 && msg.received == 11);
+
+    // Coordinates of any length
+    CHECK(parseMessage("PLAY,999999,0", msg) && msg.type == MSG_PLAY && msg.x == 999999 && msg.y == 0);
+
+    // Malformed results and commands
+    CHECK(!parseMessage("PLAY,RESULT,MAYBE", msg) && msg.type == MSG_UNKNOWN);
+    CHECK(!parseMessage("PLAY,RESULT,SUNK", msg));
+    CHECK(!parseMessage("RESUME,1", msg));
+    CHECK(!parseMessage("HELLO,1,2", msg));
+    CHECK(!parseMessage("play,1,2", msg));
+
+    // Malformed binary records
+    const char badTag[] = {'P', 1, 2};
+    const char badResult[] = {char(BIN_TAG_RESULT), 9, 0};
+    CHECK(!parseRecord(string_view(badTag, 3), msg) && msg.type == MSG_UNKNOWN);
+    CHECK(!parseRecord(string_view(badResult, 3), msg));
+    CHECK(!parseRecord(string_view(badResult, 2), msg));
+}
+
+static void testBadCoordinates() {
+    const char *bad[] = {
+        "PLAY",             // No coordinates
+        "PLAY,3",           // Only x
+        "PLAY,3,",          // Empty y
+        "PLAY,,3",          // Empty x
+        "PLAY,a,3",         // Not a number
+        "PLAY,3,4x",        // Trailing text in the field
+        "PLAY, 3,4",        // Space
+        "PLAY,-1,4",        // Negative
+        "PLAY,+1,4",        // Sign
+        "PLAY,3,99999999999999999999",  // Doesn't fit an int
+    };
+    for (const char *text : bad) {
+        Message msg;
+        msg.type = MSG_PLAY;
+        if (!CHECK(!parseMessage(text, msg) && msg.type == MSG_UNKNOWN)) cerr << "  accepted: " << text << endl;
+    }
+}
+
+int main() {
+    testSplitFrame();
+    testSeveralFrames();
+    testLineEndings();
+    testOverlongFrame();
+    testMessages();
+    testBadCoordinates();
+    return checkResult("testProtocol");
+}
@@ -0,0 +1,166 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Checks the targeting engine's incremental counts against a brute-force recount
+   Authors: Paolo Saliba and Brayton Alvarez
+
+   Compilation:
+     g++ -std=c++20 -O2 -o testTargeting testTargeting.cpp
+
+   Plays seeded games with the engine choosing every shot and, after each
+   result, counts again from scratch which placements of each ship length
+   are still possible. Every cell's count must match the engine's.
+*/
+#include <chrono>
+#include "check.h"
+#include "board.h"
+#include "fleetGenerator.h"
+#include "gameRules.h"
+#include "targeting.h"
+
+using namespace std;
+
+// Games played per configuration, half of them with sunk notices
+#define TEST_GAMES 200
+
+// What the engine has been told about the opponent's board: the hits, the
+// misses and the ships reported sunk (taken from the real board)
+template <typename Config>
+struct Seen {
+    using Plane = typename BasicBoard<Config>::Plane;
+    Plane hits;
+    Plane misses;
+    Plane sunk;      // Cells of sunk ships
+    Plane water;     // Known to hold no ship: misses, diagonals of hits, halos of sunk ships
+};
+
+// Brute-force recount of every length against the engine's counts.
+// Returns false at the first length and cell that differ.
+template <typename Config>
+static bool countsMatch(const BasicTargetingEngine<Config> &engine, const Seen<Config> &seen) {
+    constexpr int size = Config::gridSize;
+    const BasicPlacementTable<size> &table = BasicPlacementTable<size>::get();
+    for (int len = 1; len <= size; len++) {
+        bool inFleet = false;
+        for (int i = 0; i < Config::fleetCount; i++) inFleet |= Config::fleet[i] == len;
+        if (!inFleet) continue;
+
+        int count[Config::cells] = {};
+        int hitCount[Config::cells] = {};
+        for (const auto &p : table.placements(len)) {
+            // Over water or a sunk ship, or touching a hit it doesn't contain
+            if (p.ship.intersects(seen.water) || p.ship.intersects(seen.sunk)) continue;
+            if (p.halo.andNot(p.ship).intersects(seen.hits)) continue;
+            bool target = p.ship.intersects(seen.hits);
+            for (int cell = 0; cell < Config::cells; cell++) {
+                if (!p.ship.test(cell)) continue;
+                count[cell]++;
+                if (target) hitCount[cell]++;
+            }
+        }
+        for (int cell = 0; cell < Config::cells; cell++) {
+            if (engine.placementsCovering(len, cell) != count[cell] ||
+                engine.targetsCovering(len, cell) != hitCount[cell]) {
+                cerr << Config::name << ": length " << len << ", cell " << cell << ": engine "
+                     << engine.placementsCovering(len, cell) << "/" << engine.targetsCovering(len, cell)
+                     << ", recount " << count[cell] << "/" << hitCount[cell] << endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Record a result the way the engine reads it
+template <typename Config>
+static void see(Seen<Config> &seen, const BasicBoard<Config> &board, int x, int y, ShotResult result, bool sunkNotice) {
+    constexpr int size = Config::gridSize;
+    int cell = cellIndex<size>(y, x);
+    if (!isHit(result)) {
+        seen.misses.set(cell);
+        seen.water.set(cell);
+        return;
+    }
+    seen.hits.set(cell);
+    for (int dr = -1; dr <= 1; dr += 2) {
+        for (int dc = -1; dc <= 1; dc += 2) {
+            int r = y + dr, c = x + dc;
+            if (r >= 0 && r < size && c >= 0 && c < size) seen.water.set(cellIndex<size>(r, c));
+        }
+    }
+    if (!sunkNotice) return;
+
+    // The whole ship and the cells around it
+    const auto &ship = board.shipId[board.shipAt(y, x)];
+    seen.sunk |= ship;
+    for (int s = 0; s < Config::cells; s++) {
+        if (!ship.test(s)) continue;
+        for (int dr = -1; dr <= 1; dr++) {
+            for (int dc = -1; dc <= 1; dc++) {
+                int r = s / size + dr, c = s % size + dc;
+                if (r >= 0 && r < size && c >= 0 && c < size && !ship.test(cellIndex<size>(r, c))) {
+                    seen.water.set(cellIndex<size>(r, c));
+                }
+            }
+        }
+    }
+}
+
+template <typename Config>
+static void testIncrementalCounts(uint64_t seed) {
+    FleetGenerator generator(seed);
+    BasicTargetingEngine<Config> engine(Config::fleet, seed, chrono::microseconds(1000000));
+    int games = 0, shots = 0, mismatches = 0;
+
+    for (int g = 0; g < TEST_GAMES; g++) {
+        bool sunkNotices = g & 1;
+        BasicBoard<Config> board, view;
+        generator.generate(board);
+        engine.reset();
+        Seen<Config> seen;
+        if (!countsMatch(engine, seen)) mismatches++;
+
+        while (shots < 1000000) {
+            int x, y;
+            engine.nextShot(view, x, y);
+            int sunkSize = 0;
+            ShotResult result = resolveShot(board, x, y, &sunkSize);
+            bool sunk = result == RESULT_SUNK && sunkNotices;
+            if (result == RESULT_SUNK && !sunkNotices) result = RESULT_HIT;
+            recordResult(view, x, y, result);
+            engine.onResult(x, y, result);
+            if (sunk) engine.onSunk(x, y, sunkSize);
+            see(seen, board, x, y, result, sunk);
+            shots++;
+            if (result == RESULT_WIN) break;
+            if (!countsMatch(engine, seen)) {
+                mismatches++;
+                break;
+            }
+        }
+        games++;
+    }
+    CHECK(mismatches == 0);
+    cout << Config::name << ": " << games << " games, " << shots << " shots recounted" << endl;
+}
+
+static void testBudget() {
+    // The densest cells of an empty board are near the middle, never on
+    // row 0, so the whole board was scored
+    TargetingEngine engine(ClassicGame::fleet, 1);
+    Board view;
+    int x, y;
+    engine.nextShot(view, x, y);
+    CHECK(y != 0);
+
+    // With no time at all only the first row is scored
+    engine.setBudget(chrono::microseconds(0));
+    engine.nextShot(view, x, y);
+    CHECK(y == 0);
+}
+
+int main() {
+    testIncrementalCounts<SmallGame>(7);
+    testIncrementalCounts<ClassicGame>(11);
+    testIncrementalCounts<LargeGame>(13);
+    testBudget();
+    return checkResult("testTargeting");
+}
@@ -0,0 +1,89 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Low overhead turn latency tracing for the game client
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "trace.h"
+
+using namespace std;
+
+static const char *SPAN_NAMES[TRACE_SPANS] = {
+    "key scan", "key wakeup", "keypress to send", "send to result", "result to frame", "render"
+};
+
+void Tracer::collect() {
+    for (int i = 0; i < used; i++) {
+        rings[i].drain([this](const TraceSample &sample) { spans[sample.span].record(sample.ns); });
+    }
+}
+
+string Tracer::report() const {
+    char line[128];
+    string text;
+    snprintf(line, sizeof(line), "%-18s %9s %10s %10s %10s\n", "span", "count", "p50 us", "p99 us", "max us");
+    text += line;
+    for (int s = 0; s < TRACE_SPANS; s++) {
+        const LatencyHistogram &h = spans[s];
+        snprintf(line, sizeof(line), "%-18s %9llu %10.1f %10.1f %10.1f\n", SPAN_NAMES[s], (unsigned long long)h.count(),
+                 h.percentile(0.5) / 1e3, h.percentile(0.99) / 1e3, h.max() / 1e3);
+        text += line;
+    }
+    uint64_t dropped = 0;
+    for (int i = 0; i < used; i++) dropped += rings[i].droppedCount();
+    if (dropped) text += "dropped " + to_string(dropped) + " samples\n";
+    return text;
+}
+
+bool Tracer::writeFile(const string &path) const {
+    // Write a new file and rename it over the old one, so a reader never
+    // sees half a report
+    string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    string text = report();
+    bool ok = write(fd, text.data(), text.size()) == (ssize_t)text.size();
+    close(fd);
+    return ok && rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+int Tracer::listenSocket(const string &path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) return -1;
+    path.copy(addr.sun_path, path.size());
+
+    // Replace a socket left behind by an earlier run, but never a file
+    // that happens to have the same name
+    struct stat info;
+    if (lstat(path.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            errno = EADDRINUSE;
+            return -1;
+        }
+        unlink(path.c_str());
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+void Tracer::serve(int listenFd) const {
+    int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) return;
+    string text = report();
+    if (send(fd, text.data(), text.size(), MSG_NOSIGNAL | MSG_DONTWAIT) < 0) {}  // The reader went away
+    close(fd);
+}
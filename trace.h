@@ -0,0 +1,121 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Low overhead turn latency tracing for the game client
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "histogram.h"
+
+// Samples a thread can record between two collections
+#define TRACE_RING_SIZE 4096
+// Threads that can record (the event loop and the keypad scanner)
+#define TRACE_RINGS 4
+// Milliseconds between collections of the rings into the histograms
+#define TRACE_COLLECT_MS 1000
+
+using namespace std;
+
+// What a sample measures, all in nanoseconds
+enum TraceSpan {
+    TRACE_KEY_SCAN,          // One scan of the keypad matrix
+    TRACE_KEY_WAKEUP,        // Key seen by the scanner until the game takes it
+    TRACE_KEY_TO_SEND,       // Key that confirms a shot until the shot is sent
+    TRACE_SEND_TO_RESULT,    // Shot sent until its result arrives
+    TRACE_RESULT_TO_FRAME,   // Result arrived until the grids are drawn
+    TRACE_RENDER,            // Drawing the grids
+    TRACE_SPANS
+};
+
+// Monotonic time in nanoseconds, the clock KeyEvent times are taken from
+inline uint64_t traceNow() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint64_t traceTime(chrono::steady_clock::time_point time) {
+    return chrono::duration_cast<chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+struct TraceSample {
+    uint32_t span;
+    uint64_t ns;
+};
+
+// Samples recorded by one thread and collected by another. Recording is two
+// stores and a release, with no lock and no system call. A full ring drops
+// the sample and counts it.
+class TraceRing {
+    private:
+        TraceSample samples[TRACE_RING_SIZE];
+        alignas(64) atomic<size_t> head{0};   // Next sample to collect
+        alignas(64) atomic<size_t> tail{0};   // Next slot to record into
+        atomic<uint64_t> dropped{0};
+
+    public:
+        // Only from the thread the ring was given to
+        void record(TraceSpan span, uint64_t ns) {
+            size_t t = tail.load(memory_order_relaxed);
+            if (t - head.load(memory_order_acquire) == TRACE_RING_SIZE) {
+                dropped.store(dropped.load(memory_order_relaxed) + 1, memory_order_relaxed);
+                return;
+            }
+            samples[t & (TRACE_RING_SIZE - 1)] = {uint32_t(span), ns};
+            tail.store(t + 1, memory_order_release);
+        }
+
+        // Time since start, taken from traceNow()
+        void since(TraceSpan span, uint64_t start) {
+            uint64_t now = traceNow();
+            record(span, now > start ? now - start : 0);
+        }
+
+        // Only from the collecting thread: pass every sample to fn
+        template <typename Fn>
+        void drain(Fn fn) {
+            size_t h = head.load(memory_order_relaxed);
+            size_t t = tail.load(memory_order_acquire);
+            for (; h != t; h++) fn(samples[h & (TRACE_RING_SIZE - 1)]);
+            head.store(h, memory_order_release);
+        }
+
+        uint64_t droppedCount() const { return dropped.load(memory_order_relaxed); }
+};
+
+// Hands out one ring per recording thread and adds their samples up in a
+// histogram per span. collect() and everything after it run on one thread
+// (the event loop), so the histograms need no lock either.
+class Tracer {
+    private:
+        TraceRing rings[TRACE_RINGS];
+        int used = 0;
+        LatencyHistogram spans[TRACE_SPANS];
+
+    public:
+        // A ring for the calling thread or the one it is passed to, or
+        // nullptr if all are taken (that thread then records nothing).
+        TraceRing *attach() { return used < TRACE_RINGS ? &rings[used++] : nullptr; }
+
+        // Move the samples out of the rings into the histograms
+        void collect();
+
+        // p50, p99 and max per span, one line each
+        string report() const;
+
+        // Write the report to path, replacing it. Returns false on failure.
+        bool writeFile(const string &path) const;
+
+        // Listen on a UNIX socket at path: each connection gets the report.
+        // A stale socket at path is replaced, any other file is left alone.
+        // Returns the listening fd, or -1 (errno EADDRINUSE for a file).
+        static int listenSocket(const string &path);
+
+        // Accept one connection on fd and send it the report
+        void serve(int listenFd) const;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,96 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Work-stealing thread pool for batches of independent jobs
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#include "workPool.h"
+
+using namespace std;
+
+// Index of the worker running on this thread, -1 outside the pool
+static thread_local int currentWorker = -1;
+
+WorkStealingPool::WorkStealingPool(int numThreads) {
+    int count = numThreads > 0 ? numThreads : max(1u, thread::hardware_concurrency());
+    for (int i = 0; i < count; i++) queues.push_back(make_unique<JobQueue>());
+    for (int i = 0; i < count; i++) threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard<mutex> guard(sleepLock);
+        stopping = true;
+    }
+    workReady.notify_all();
+    for (thread &t : threads) t.join();
+}
+
+void WorkStealingPool::submit(PoolJob job) {
+    int target = currentWorker >= 0 ? currentWorker : nextQueue++ % queues.size();
+    pending++;
+    {
+        lock_guard<mutex> guard(queues[target]->lock);
+        queues[target]->jobs.push_back(move(job));
+    }
+    // Take the sleep lock so a worker that just found nothing to do
+    // can't miss this wakeup
+    { lock_guard<mutex> guard(sleepLock); }
+    workReady.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    unique_lock<mutex> guard(sleepLock);
+    allDone.wait(guard, [this] { return pending.load() == 0; });
+}
+
+bool WorkStealingPool::takeJob(int worker, PoolJob &job) {
+    // Own queue first, newest job (its data is most likely still in cache)
+    {
+        JobQueue &own = *queues[worker];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.jobs.empty()) {
+            job = move(own.jobs.back());
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    // Then the oldest job of the others, starting with the next worker
+    for (size_t i = 1; i < queues.size(); i++) {
+        JobQueue &victim = *queues[(worker + i) % queues.size()];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.jobs.empty()) {
+            job = move(victim.jobs.front());
+            victim.jobs.pop_front();
+            stolen++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(int worker) {
+    currentWorker = worker;
+    while (true) {
+        PoolJob job;
+        if (takeJob(worker, job)) {
+            job(worker);
+            if (--pending == 0) {
+                lock_guard<mutex> guard(sleepLock);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        unique_lock<mutex> guard(sleepLock);
+        if (stopping) return;
+        // Sleep until something is queued. The check is repeated under the
+        // lock: submit() queues the job, then takes and releases this lock
+        // before notifying, so either the job is seen here or the notify
+        // comes after wait() has released the lock.
+        bool anyQueued = false;
+        for (auto &q : queues) {
+            lock_guard<mutex> qguard(q->lock);
+            if (!q->jobs.empty()) anyQueued = true;
+        }
+        if (!anyQueued) workReady.wait(guard);
+    }
+}
@@ -0,0 +1,65 @@
+/* ECEGRE-2020 - Seattle University
+   Description: Work-stealing thread pool for batches of independent jobs
+   Authors: Paolo Saliba and Brayton Alvarez
+*/
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// A job gets the index of the worker running it, so it can use state that
+// belongs to that worker (RNG, scratch boards, counters) without locking.
+using PoolJob = function<void(int worker)>;
+
+// Fixed set of worker threads, each with its own job queue. A worker takes
+// its newest job first and, when its queue is empty, steals the oldest job
+// of another worker, so uneven jobs still keep every core busy.
+class WorkStealingPool {
+    private:
+        struct JobQueue {
+            mutex lock;
+            deque<PoolJob> jobs;
+        };
+
+        vector<unique_ptr<JobQueue>> queues;
+        vector<thread> threads;
+        atomic<size_t> pending{0};          // Submitted and not finished
+        atomic<uint64_t> stolen{0};
+        atomic<unsigned> nextQueue{0};
+        mutex sleepLock;
+        condition_variable workReady;
+        condition_variable allDone;
+        bool stopping = false;
+
+        void workerLoop(int worker);
+        bool takeJob(int worker, PoolJob &job);
+
+    public:
+        // numThreads 0 uses one worker per core
+        explicit WorkStealingPool(int numThreads = 0);
+        ~WorkStealingPool();
+
+        int size() const { return queues.size(); }
+
+        // Queue a job. From inside a job it goes on the caller's own queue,
+        // otherwise the queues are filled in turn.
+        void submit(PoolJob job);
+
+        // Block until every submitted job has finished
+        void wait();
+
+        // Jobs run by a worker other than the one they were queued on
+        uint64_t steals() const { return stolen.load(); }
+};
+
+#endif // WORKPOOL_H